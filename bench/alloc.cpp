@@ -0,0 +1,56 @@
+// Benchmark: node allocation with heap_alloc (one new per node) vs arena_alloc (chunks + free list)
+// build, lookup, deep copy, erase + insert and teardown
+#include "bench.hpp"
+#include "bst.hpp"
+
+template<typename T>
+void run(const char* variant, const std::vector<int>& keys, const std::vector<int>& queries) {
+    timer t;
+    {
+        T tree;
+        for (auto k : keys) {
+            tree.insert(std::pair<int,int>{k, k});
+        }
+        report("build", variant, keys.size(), t.seconds());
+
+        t.restart();
+        long sum = 0;
+        for (auto k : queries) {
+            sum += tree.find(k).value();
+        }
+        do_not_optimize(sum);
+        report("lookup", variant, queries.size(), t.seconds());
+
+        t.restart();
+        {
+            T copy{tree};
+            report("copy", variant, keys.size(), t.seconds());
+            t.restart();
+        }
+        report("copy teardown", variant, keys.size(), t.seconds());
+
+        t.restart();
+        for (std::size_t i = 0; i < keys.size(); i += 2) {
+            tree.erase(keys[i]);
+        }
+        for (std::size_t i = 0; i < keys.size(); i += 2) {
+            tree.insert(std::pair<int,int>{keys[i], 0});    // reuses the erased nodes
+        }
+        report("erase+insert", variant, keys.size(), t.seconds());
+
+        t.restart();
+    }                                                        // teardown
+    report("teardown", variant, keys.size(), t.seconds());
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+    auto keys = random_keys(n);
+    auto queries = random_keys(n, 7);
+
+    run<bst<int,int>>("heap_alloc", keys, queries);
+    run<bst<int,int,std::less<int>,no_balance,arena_alloc<>>>("arena_alloc", keys, queries);
+    run<bst<int,int,std::less<int>,avl_balance>>("avl + heap_alloc", keys, queries);
+    run<bst<int,int,std::less<int>,avl_balance,arena_alloc<>>>("avl + arena_alloc", keys, queries);
+    return 0;
+}
@@ -0,0 +1,55 @@
+// Benchmark: batched lookups (find_batch, contains_batch) vs a loop of find, for batch sizes 8 to 1024
+// the tree should not fit in the last level cache, e.g. ./bench/batch.x 4000000
+#include "bench.hpp"
+#include "bst.hpp"
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 4000000);
+    auto keys = random_keys(n);
+    auto queries = random_keys(n, 7);
+
+    bst<int,int,std::less<int>,avl_balance,arena_alloc<>> tree;
+    for (auto k : keys) {
+        tree.insert(std::pair<int,int>{k, k});
+    }
+    using iterator = decltype(tree.find(0));
+
+    char variant[32];
+    for (std::size_t batch = 8; batch <= 1024; batch *= 2) {
+        std::vector<iterator> found(batch);
+        std::vector<char> present(batch);
+
+        timer t;
+        long sum = 0;
+        for (std::size_t i = 0; i + batch <= n; i += batch) {
+            for (std::size_t j = 0; j < batch; ++j) {
+                found[j] = tree.find(queries[i + j]);
+            }
+            sum += found[batch - 1].value();
+        }
+        do_not_optimize(sum);
+        std::snprintf(variant, sizeof variant, "find loop, batch %zu", batch);
+        report("lookup", variant, n, t.seconds());
+
+        t.restart();
+        sum = 0;
+        for (std::size_t i = 0; i + batch <= n; i += batch) {
+            tree.find_batch(queries.begin() + i, queries.begin() + i + batch, found.begin());
+            sum += found[batch - 1].value();
+        }
+        do_not_optimize(sum);
+        std::snprintf(variant, sizeof variant, "find_batch, batch %zu", batch);
+        report("lookup", variant, n, t.seconds());
+
+        t.restart();
+        sum = 0;
+        for (std::size_t i = 0; i + batch <= n; i += batch) {
+            tree.contains_batch(queries.begin() + i, queries.begin() + i + batch, present.begin());
+            sum += present[batch - 1];
+        }
+        do_not_optimize(sum);
+        std::snprintf(variant, sizeof variant, "contains_batch, batch %zu", batch);
+        report("lookup", variant, n, t.seconds());
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+#ifndef _bst_bench
+#define _bst_bench
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+/**
+ * ********* Benchmark helpers *********
+ *
+ * shared by the programs in folder bench, built with "make bench"
+ * every program takes the number of keys as first command line argument
+ */
+
+
+/** class timer
+ * measures the wall-clock time elapsed since its construction (or the last restart)
+ */
+class timer {
+    using clock = std::chrono::steady_clock;
+    clock::time_point start{clock::now()};
+
+ public:
+    void restart() noexcept {start = clock::now();}
+
+    /** @return returns the elapsed time in seconds */
+    double seconds() const noexcept {
+        return std::chrono::duration<double>(clock::now() - start).count();
+    }
+};
+
+
+/** function bench_size
+ * @return returns the number given as argument i on the command line, or def
+ */
+inline std::size_t bench_size(int argc, char** argv, int i, std::size_t def) {
+    return argc > i ? static_cast<std::size_t>(std::strtoull(argv[i], nullptr, 10)) : def;
+}
+
+
+/** function random_keys
+ * @return returns the keys 0, 1, ..., n-1 in random order
+ */
+inline std::vector<int> random_keys(std::size_t n, unsigned seed = 42) {
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937{seed});
+    return keys;
+}
+
+
+/** function report
+ * prints one line of results: total time and time per operation
+ */
+inline void report(const char* operation, const char* variant, std::size_t n, double seconds) {
+    std::printf("%-14s %-28s n=%-11zu %10.2f ms %9.1f ns/op\n",
+                operation, variant, n, seconds * 1e3, n ? seconds * 1e9 / n : 0.0);
+}
+
+
+/** function report_rate
+ * prints one line of results for a stream: total time and throughput
+ */
+inline void report_rate(const char* operation, const char* variant, std::size_t bytes, double seconds) {
+    std::printf("%-14s %-28s %8.1f MB %10.2f ms %9.1f MB/s\n",
+                operation, variant, bytes / 1e6, seconds * 1e3, seconds > 0 ? bytes / 1e6 / seconds : 0.0);
+}
+
+
+/** function do_not_optimize
+ * prevents the compiler from removing the computation of x
+ */
+template<typename T>
+inline void do_not_optimize(const T& x) {
+    asm volatile("" : : "g"(&x) : "memory");
+}
+
+#endif
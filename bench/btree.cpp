@@ -0,0 +1,75 @@
+// Benchmark: binary nodes (bst) vs B+tree nodes (btree) with integer keys
+// build, lookup, in-order iteration and memory per entry
+// e.g. ./bench/btree.x 100000000 (needs about 5 GB: 40 bytes per key for the binary trees, plus malloc overhead)
+#include "bench.hpp"
+#include "bst.hpp"
+#include "btree.hpp"
+
+#include <new>
+
+/** bytes requested to operator new (without the overhead of malloc), counted by the replacement below */
+static std::size_t allocated = 0;
+
+void* operator new(std::size_t size) {
+    allocated += size;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    allocated += size;
+    if (void* p = std::aligned_alloc(static_cast<std::size_t>(align), size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t) noexcept {std::free(p);}
+void operator delete(void* p, std::align_val_t) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {std::free(p);}
+
+template<typename T>
+void run(const char* variant, const std::vector<int>& keys, const std::vector<int>& queries) {
+    std::size_t before = allocated;
+    timer t;
+    T tree;
+    for (auto k : keys) {
+        tree.insert(std::pair<int,int>{k, k});
+    }
+    report("build", variant, keys.size(), t.seconds());
+    std::size_t bytes = allocated - before;
+
+    t.restart();
+    long sum = 0;
+    for (auto k : queries) {
+        sum += tree.find(k).value();
+    }
+    do_not_optimize(sum);
+    report("lookup", variant, queries.size(), t.seconds());
+
+    t.restart();
+    sum = 0;
+    for (auto it = tree.begin(); it != tree.end(); ++it) {
+        sum += it.value();
+    }
+    do_not_optimize(sum);
+    report("iterate", variant, keys.size(), t.seconds());
+    std::printf("%-14s %-28s %.1f bytes/entry\n", "memory", variant, keys.empty() ? 0.0 : double(bytes) / keys.size());
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+    auto keys = random_keys(n);
+    auto queries = random_keys(n, 7);
+
+    run<bst<int,int>>("bst", keys, queries);
+    run<bst<int,int,std::less<int>,avl_balance>>("bst avl", keys, queries);
+    run<bst<int,int,std::less<int>,avl_balance,arena_alloc<>>>("bst avl + arena_alloc", keys, queries);
+    run<btree<int,int,std::less<int>,128>>("btree 128 bytes", keys, queries);
+    run<btree<int,int>>("btree 256 bytes", keys, queries);
+    run<btree<int,int,std::less<int>,512>>("btree 512 bytes", keys, queries);
+    return 0;
+}
@@ -0,0 +1,106 @@
+// Benchmark: compact nodes (compact_bst, 32-bit indices in one array) vs the nodes of bst with int keys
+// bytes per entry, build, lookup, in-order iteration, copy and erase; compact_bst is measured again
+// after shrink_to_fit, which lays the nodes out in key order
+// the bytes per entry do not include the header that malloc adds to every node of bst (8 to 16 bytes)
+// argument: number of keys
+#include "bench.hpp"
+#include "bst.hpp"
+#include "compact.hpp"
+
+#include <new>
+
+/** bytes requested to operator new (without the overhead of malloc), counted by the replacement below */
+static std::size_t allocated = 0;
+
+void* operator new(std::size_t size) {
+    allocated += size;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    allocated += size;
+    if (void* p = std::aligned_alloc(static_cast<std::size_t>(align), size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t) noexcept {std::free(p);}
+void operator delete(void* p, std::align_val_t) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {std::free(p);}
+
+template<typename T>
+void queries(const char* variant, T& tree, const std::vector<int>& keys, const std::vector<int>& lookups) {
+    timer t;
+    long sum = 0;
+    for (auto k : lookups) {
+        sum += tree.find(k).value();
+    }
+    do_not_optimize(sum);
+    report("lookup", variant, lookups.size(), t.seconds());
+
+    t.restart();
+    sum = 0;
+    for (auto it = tree.begin(); it != tree.end(); ++it) {
+        sum += it.value();
+    }
+    do_not_optimize(sum);
+    report("iterate", variant, keys.size(), t.seconds());
+}
+
+template<typename T>
+void run(const char* variant, const std::vector<int>& keys, const std::vector<int>& lookups) {
+    std::size_t before = allocated;
+    timer t;
+    T tree;
+    for (auto k : keys) {
+        tree.insert(std::pair<int,int>{k, k});
+    }
+    report("build", variant, keys.size(), t.seconds());
+    std::size_t bytes = allocated - before;
+    if constexpr (std::is_same<T, compact_bst<int,int>>::value) {
+        bytes = tree.memory();                    // the array only: the growths of the vector are counted too
+    }
+    std::printf("%-14s %-28s %.1f bytes/entry\n", "memory", variant, keys.empty() ? 0.0 : double(bytes) / keys.size());
+
+    queries(variant, tree, keys, lookups);
+
+    t.restart();
+    T copy{tree};
+    report("copy", variant, keys.size(), t.seconds());
+
+    t.restart();
+    for (auto k : keys) {
+        copy.erase(k);
+    }
+    report("erase", variant, keys.size(), t.seconds());
+
+    if constexpr (std::is_same<T, compact_bst<int,int>>::value) {
+        std::string packed = std::string{variant} + ", packed";
+        t.restart();
+        tree.shrink_to_fit();
+        report("shrink_to_fit", variant, keys.size(), t.seconds());
+        std::printf("%-14s %-28s %.1f bytes/entry\n", "memory", packed.c_str(),
+                    keys.empty() ? 0.0 : double(tree.memory()) / keys.size());
+        queries(packed.c_str(), tree, keys, lookups);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+    auto keys = random_keys(n);
+    auto lookups = random_keys(n, 7);
+    std::printf("node size: bst %zu bytes, bst avl %zu bytes, compact_bst %zu bytes\n",
+                sizeof(_node<int,int,no_balance::meta,heap_alloc>), sizeof(_node<int,int,avl_balance::meta,heap_alloc>),
+                sizeof(compact_bst<int,int>::node));
+
+    run<bst<int,int>>("bst", keys, lookups);
+    run<bst<int,int,std::less<int>,avl_balance>>("bst avl", keys, lookups);
+    run<bst<int,int,std::less<int>,avl_balance,arena_alloc<>>>("bst avl + arena_alloc", keys, lookups);
+    run<compact_bst<int,int>>("compact_bst", keys, lookups);
+    return 0;
+}
@@ -0,0 +1,46 @@
+"""Compares two runs of bench/suite.x stored in CSV files (or two labels of the same file).
+
+Prints the operations whose time per operation changed by more than the threshold
+(10% by default) and exits with status 1 if any of them got slower.
+
+usage: python3 bench/compare.py old.csv new.csv [threshold]
+       python3 bench/compare.py results.csv:before results.csv:after [threshold]
+"""
+import csv
+import sys
+
+
+def load(arg):
+    """returns {(structure, keys, operation, n): ns_per_op} for the file (and label) in arg"""
+    path, _, label = arg.partition(":")
+    rows = {}
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            if label and row["label"] != label:
+                continue
+            key = (row["structure"], row["keys"], row["operation"], int(row["n"]))
+            rows[key] = float(row["ns_per_op"])    # the last run of a label wins
+    return rows
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return 2
+    old, new = load(sys.argv[1]), load(sys.argv[2])
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 0.10
+    slower = 0
+    for key in sorted(old.keys() & new.keys()):
+        before, after = old[key], new[key]
+        if before <= 0:
+            continue
+        change = after / before - 1
+        if abs(change) > threshold:
+            slower += change > 0
+            print("%-7s %-20s %-8s %-11s n=%-10d %9.1f -> %9.1f ns/op (%+.0f%%)"
+                  % ("SLOWER" if change > 0 else "faster", *key, before, after, 100 * change))
+    return 1 if slower else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
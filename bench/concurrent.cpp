@@ -0,0 +1,96 @@
+// Benchmark: throughput of concurrent_bst vs a bst (avl_balance) behind a global mutex
+// read/write mixes (100%, 90% and 50% lookups, the rest half insertions and half removals), 1 to 64 threads;
+// random keys, and sorted keys: the tree is filled in increasing order and the insertions append increasing keys
+// arguments: number of keys in the tree, total number of operations
+#include "bench.hpp"
+#include "bst.hpp"
+#include "concurrent.hpp"
+
+#include <thread>
+#include <mutex>
+
+/** bst with every operation under one mutex, as the code using bst does today (balanced, as concurrent_bst) */
+class locked_bst {
+    bst<int,int,std::less<int>,avl_balance> tree;
+    mutable std::mutex m;
+
+ public:
+    bool insert(const std::pair<int,int>& x) {
+        std::lock_guard<std::mutex> lock{m};
+        return tree.try_emplace(x.first, x.second).second;
+    }
+    bool erase(int x) {
+        std::lock_guard<std::mutex> lock{m};
+        bool present = tree.contains(x);
+        if (present) {
+            tree.erase(x);
+        }
+        return present;
+    }
+    bool contains(int x) const {
+        std::lock_guard<std::mutex> lock{m};
+        return tree.contains(x);
+    }
+};
+
+/** runs ops operations split among threads, reads_percent of them lookups
+ * sorted: the insertions append keys greater than range/2, increasing */
+template<typename T>
+void run(const char* name, T& tree, std::size_t threads, unsigned reads_percent, std::size_t ops, std::size_t range, bool sorted) {
+    std::vector<std::thread> workers;
+    timer t;
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&tree, i, threads, reads_percent, ops, range, sorted] {
+            std::mt19937 gen{static_cast<unsigned>(i)};
+            long found = 0;
+            for (std::size_t j = 0; j < ops / threads; ++j) {
+                int key = static_cast<int>(gen() % range);
+                unsigned op = gen() % 100;
+                if (op < reads_percent) {
+                    found += tree.contains(key);
+                }
+                else if (op % 2) {
+                    if (sorted) {
+                        key = static_cast<int>(range / 2 + j * threads + i);
+                    }
+                    tree.insert(std::pair<int,int>{key, key});
+                }
+                else {
+                    tree.erase(key);
+                }
+            }
+            do_not_optimize(found);
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    char variant[48];
+    std::snprintf(variant, sizeof variant, "%s, %zu threads", name, threads);
+    char operation[32];
+    std::snprintf(operation, sizeof operation, "%u%% reads%s", reads_percent, sorted ? ", sorted" : "");
+    report(operation, variant, ops, t.seconds());
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+    std::size_t ops = bench_size(argc, argv, 2, 2000000);
+    auto keys = random_keys(2 * n);
+
+    for (bool sorted : {false, true}) {
+        for (unsigned reads : {100u, 90u, 50u}) {
+            for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+                concurrent_bst<int,int> concurrent;
+                locked_bst locked;
+                for (std::size_t i = 0; i < n; ++i) {           // half of the keys of the range
+                    int key = sorted ? static_cast<int>(i) : keys[i];
+                    concurrent.insert(std::pair<int,int>{key, key});
+                    locked.insert(std::pair<int,int>{key, key});
+                }
+                run("concurrent_bst", concurrent, threads, reads, ops, 2 * n, sorted);
+                run("bst + mutex", locked, threads, reads, ops, 2 * n, sorted);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+// Benchmark: throughput of the streaming export and import of bst (text, csv, binary records)
+// vs operator<<, which writes only the keys, one at a time through std::ostream
+// arguments: number of keys, directory of the temporary files
+#include "bench.hpp"
+#include "bst.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+/** size of a file in bytes */
+std::size_t file_size(const std::string& path) {
+    std::ifstream is{path, std::ios::binary | std::ios::ate};
+    return static_cast<std::size_t>(is.tellg());
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 2000000);
+    std::string path = std::string{argc > 2 ? argv[2] : "."} + "/bench_records";
+    auto keys = random_keys(n);
+
+    bst<int,double> tree;
+    std::vector<std::pair<int,double>> pairs;
+    for (auto k : keys) {
+        pairs.emplace_back(k, k * 0.25);
+    }
+    tree.assign(pairs.begin(), pairs.end());
+
+    timer t;
+    {
+        std::ofstream os{path};
+        os << tree;
+    }
+    report_rate("write", "operator<< (keys only)", file_size(path), t.seconds());
+
+    struct format {
+        const char* name;
+        record_format f;
+    };
+    for (auto fmt : {format{"text", record_format::text}, format{"csv", record_format::csv},
+                     format{"binary", record_format::binary}}) {
+        char variant[32];
+        std::snprintf(variant, sizeof variant, "export %s, ostream", fmt.name);
+        t.restart();
+        {
+            std::ofstream os{path, std::ios::binary};
+            tree.export_records(ostream_sink{os}, fmt.f);
+        }
+        report_rate("write", variant, file_size(path), t.seconds());
+
+        std::snprintf(variant, sizeof variant, "export %s, FILE*", fmt.name);
+        t.restart();
+        std::FILE* out = std::fopen(path.c_str(), "wb");
+        tree.export_records(file_sink{out}, fmt.f);
+        std::fclose(out);
+        report_rate("write", variant, file_size(path), t.seconds());
+
+        std::snprintf(variant, sizeof variant, "import %s, FILE*", fmt.name);
+        t.restart();
+        bst<int,double> copy;
+        std::FILE* in = std::fopen(path.c_str(), "rb");
+        copy.import_records(file_source{in}, fmt.f);
+        std::fclose(in);
+        report_rate("read", variant, file_size(path), t.seconds());
+    }
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Benchmark: node handles
+// moves the n entries of a tree (built with random keys) to another one, and changes the key of n entries:
+// extract + insert of the node handle against copying the pair, erase and insert, with a value of 256 bytes
+// (std::array, a copy is a memcpy) and a std::vector of 32 doubles (a copy allocates), for heap_alloc and
+// arena_alloc (with two arenas the pair is moved into a node of the other pool)
+// argument: number of keys
+#include "bench.hpp"
+#include "bst.hpp"
+
+#include <array>
+#include <string>
+#include <type_traits>
+
+using array_value = std::array<double, 32>;
+using vector_value = std::vector<double>;
+
+/** 32 doubles, the first one equal to k */
+template<typename V>
+V make_value(int k) {
+    V value{};
+    if constexpr (std::is_same<V, vector_value>::value) {
+        value.resize(32);
+    }
+    value[0] = static_cast<double>(k);
+    return value;
+}
+
+template<typename T, typename V>
+T build(const std::vector<int>& keys) {
+    T tree;
+    for (auto k : keys) {
+        tree.insert(std::pair<int,V>{k, make_value<V>(k)});
+    }
+    return tree;
+}
+
+template<typename V, typename T>
+void run(const char* name, const std::vector<int>& keys) {
+    std::size_t n = keys.size();
+    std::vector<int> order(n);                   // the entries are moved in order of key, so that the
+    std::iota(order.begin(), order.end(), 0);    // descents hit the cache and the rest is measured
+    int shift = static_cast<int>(n);
+    std::string handle = std::string{name} + ", extract";
+    std::string copy = std::string{name} + ", erase + insert";
+
+    T from = build<T, V>(keys);
+    T to;
+    timer t;
+    for (auto k : order) {
+        to.insert(from.extract(k));
+    }
+    report("move entry", handle.c_str(), n, t.seconds());
+
+    from = build<T, V>(keys);
+    to = T{};
+    t.restart();
+    for (auto k : order) {
+        auto it = from.find(k);
+        std::pair<int,V> entry{k, it.value()};
+        from.erase(k);
+        to.insert(std::move(entry));
+    }
+    report("move entry", copy.c_str(), n, t.seconds());
+
+    t.restart();
+    for (auto k : order) {
+        auto nh = to.extract(k);
+        nh.key() += shift;
+        to.insert(std::move(nh));
+    }
+    report("change key", handle.c_str(), n, t.seconds());
+
+    t.restart();
+    for (auto k : order) {
+        auto it = to.find(k + shift);
+        std::pair<int,V> entry{k, it.value()};
+        to.erase(k + shift);
+        to.insert(std::move(entry));
+    }
+    report("change key", copy.c_str(), n, t.seconds());
+    do_not_optimize(to.size());
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 200000);
+    auto keys = random_keys(n);
+
+    run<array_value, bst<int,array_value,std::less<int>,avl_balance>>("avl, array", keys);
+    run<array_value, bst<int,array_value,std::less<int>,avl_balance,arena_alloc<>>>("avl arena, array", keys);
+    run<vector_value, bst<int,vector_value,std::less<int>,avl_balance>>("avl, vector", keys);
+    run<vector_value, bst<int,vector_value,std::less<int>,avl_balance,arena_alloc<>>>("avl arena, vector", keys);
+    return 0;
+}
@@ -0,0 +1,53 @@
+// Benchmark: lookups in the pointer trees (bst, btree) vs the frozen Eytzinger snapshot
+// e.g. ./bench/frozen.x 10000000
+#include "bench.hpp"
+#include "bst.hpp"
+#include "btree.hpp"
+
+template<typename T>
+void lookups(const char* variant, const T& tree, const std::vector<int>& queries) {
+    timer t;
+    long sum = 0;
+    for (auto k : queries) {
+        sum += tree.find(k).value();
+    }
+    do_not_optimize(sum);
+    report("find", variant, queries.size(), t.seconds());
+
+    t.restart();
+    sum = 0;
+    for (auto k : queries) {
+        sum += *tree.lower_bound(k);
+    }
+    do_not_optimize(sum);
+    report("lower_bound", variant, queries.size(), t.seconds());
+
+    t.restart();
+    sum = 0;
+    for (auto it = tree.begin(); it != tree.end(); ++it) {
+        sum += it.value();
+    }
+    do_not_optimize(sum);
+    report("iterate", variant, queries.size(), t.seconds());
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+    auto keys = random_keys(n);
+    auto queries = random_keys(n, 7);
+
+    bst<int,int,std::less<int>,avl_balance,arena_alloc<>> tree;
+    btree<int,int> b_tree;
+    for (auto k : keys) {
+        tree.insert(std::pair<int,int>{k, k});
+        b_tree.insert(std::pair<int,int>{k, k});
+    }
+    lookups("bst avl + arena_alloc", tree, queries);
+    lookups("btree", b_tree, queries);
+
+    timer t;
+    auto frozen = tree.freeze();
+    report("freeze", "frozen_bst", n, t.seconds());
+    lookups("frozen_bst", frozen, queries);
+    return 0;
+}
@@ -0,0 +1,48 @@
+// Benchmark: ingest rate of insert with and without hint, for sequential, nearly sequential and random keys
+#include "bench.hpp"
+#include "bst.hpp"
+
+using tree_t = bst<int,int,std::less<int>,avl_balance>;
+
+enum class hint_t {none, end, last};
+
+void run(const char* keys_name, const char* variant, const std::vector<int>& keys, hint_t h) {
+    timer t;
+    tree_t tree;
+    auto last = tree.end();
+    for (auto k : keys) {
+        switch (h) {
+            case hint_t::none: tree.insert(std::pair<int,int>{k, k}); break;
+            case hint_t::end:  tree.insert(tree.end(), std::pair<int,int>{k, k}); break;
+            case hint_t::last: last = tree.insert(last, std::pair<int,int>{k, k}); break;
+        }
+    }
+    report(keys_name, variant, keys.size(), t.seconds());
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+
+    std::vector<int> sequential(n);
+    std::iota(sequential.begin(), sequential.end(), 0);
+
+    // mostly increasing: each key is swapped with a close one with probability 1/8
+    auto nearly = sequential;
+    std::mt19937 gen{42};
+    for (std::size_t i = 0; i + 4 < n; ++i) {
+        if (gen() % 8 == 0) {
+            std::swap(nearly[i], nearly[i + 1 + gen() % 3]);
+        }
+    }
+
+    auto random = random_keys(n);
+
+    for (auto& [name, keys] : {std::pair<const char*, const std::vector<int>&>{"sequential", sequential},
+                               {"nearly sorted", nearly},
+                               {"random", random}}) {
+        run(name, "insert", keys, hint_t::none);
+        run(name, "insert(end(), x)", keys, hint_t::end);
+        run(name, "insert(last, x)", keys, hint_t::last);
+    }
+    return 0;
+}
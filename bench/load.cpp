@@ -0,0 +1,65 @@
+// Benchmark: startup time of a tree stored in a file
+// text file read with operator>> and inserted key by key (as done today), vs the binary file of bst::save
+// loaded by bst::load (bulk build) and mapped by frozen_bst::load (followed by n lookups, which read the pages)
+// arguments: number of keys, directory of the temporary files
+#include "bench.hpp"
+#include "bst.hpp"
+
+#include <fstream>
+#include <string>
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+    std::string dir = argc > 2 ? argv[2] : ".";
+    std::string text_path = dir + "/bench_tree.txt";
+    std::string binary_path = dir + "/bench_tree.bin";
+    auto keys = random_keys(n);
+
+    bst<int,int,std::less<int>,avl_balance> tree;
+    for (auto k : keys) {
+        tree.insert(std::pair<int,int>{k, 2 * k});
+    }
+    {
+        std::ofstream os{text_path};
+        for (auto it = tree.begin(); it != tree.end(); ++it) {
+            os << *it << ' ' << it.value() << '\n';
+        }
+    }
+    timer t;
+    tree.save(binary_path);
+    report("save", "binary", n, t.seconds());
+
+    t.restart();
+    {
+        bst<int,int,std::less<int>,avl_balance> text_tree;
+        std::ifstream is{text_path};
+        int key, value;
+        while (is >> key >> value) {
+            text_tree.insert(std::pair<int,int>{key, value});
+        }
+        do_not_optimize(text_tree);
+    }
+    report("load", "text + insert", n, t.seconds());
+
+    t.restart();
+    {
+        bst<int,int,std::less<int>,avl_balance> binary_tree;
+        binary_tree.load(binary_path);
+        do_not_optimize(binary_tree);
+    }
+    report("load", "binary + bulk build", n, t.seconds());
+
+    t.restart();
+    auto mapped = frozen_bst<int,int>::load(binary_path);
+    report("load", "mapped frozen_bst", n, t.seconds());
+    long sum = 0;
+    for (auto k : keys) {
+        sum += mapped.find(k).value();
+    }
+    do_not_optimize(sum);
+    report("find", "mapped, first touch", n, t.seconds());
+
+    std::remove(text_path.c_str());
+    std::remove(binary_path.c_str());
+    return 0;
+}
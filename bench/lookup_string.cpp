@@ -0,0 +1,73 @@
+// Benchmark: lookups in a tree with std::string keys
+// std::less<std::string> needs a temporary string for every string_view / const char* query,
+// the transparent std::less<> compares them with the keys directly
+#include "bench.hpp"
+#include "bst.hpp"
+
+#include <new>
+#include <string>
+#include <string_view>
+
+/** number of calls to operator new, counted by the replacement below */
+static std::size_t allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t) noexcept {std::free(p);}
+
+/** keys long enough to defeat the small string optimization */
+static std::string make_key(int i) {
+    return "key-with-a-long-common-prefix-" + std::to_string(i);
+}
+
+/** looks up all the queries, converted by the function key (the conversion is timed too) */
+template<typename T, typename Q, typename F>
+void run(const char* operation, const char* variant, const T& tree, const std::vector<Q>& queries, F key) {
+    allocations = 0;
+    timer t;
+    long found = 0;
+    for (const auto& q : queries) {
+        found += tree.find(key(q)) != tree.end();
+    }
+    do_not_optimize(found);
+    report(operation, variant, queries.size(), t.seconds());
+    std::printf("%-14s %-28s allocations=%zu\n", "", variant, allocations);
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 200000);
+    std::vector<std::string> keys;
+    for (auto i : random_keys(n)) {
+        keys.push_back(make_key(i));
+    }
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    std::vector<const char*> literals;
+    for (const auto& k : keys) {
+        literals.push_back(k.c_str());
+    }
+
+    bst<std::string,int,std::less<std::string>,avl_balance> plain;
+    bst<std::string,int,std::less<>,avl_balance> transparent;
+    for (const auto& k : keys) {
+        plain.try_emplace(k, 0);
+        transparent.try_emplace(k, 0);
+    }
+
+    auto same = [](const auto& q) -> const auto& {return q;};
+    auto to_string = [](const auto& q) {return std::string(q);};   // what a non transparent tree needs
+
+    run("find string", "std::less<std::string>", plain, keys, same);
+    run("find string", "std::less<>", transparent, keys, same);
+    run("find view", "std::less<std::string>", plain, views, to_string);
+    run("find view", "std::less<>", transparent, views, same);
+    run("find char*", "std::less<std::string>", plain, literals, to_string);
+    run("find char*", "std::less<>", transparent, literals, same);
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Benchmark: merge, split, join and the set operations of bst
+// merge of two trees of n/2 random keys (interleaved and disjoint) and of a small tree into a large one,
+// against inserting the keys of the second tree one by one; split at the median and join back;
+// set_union, set_intersection and set_difference against the std::set_* algorithms on the two sorted sequences
+// argument: number of keys
+#include "bench.hpp"
+#include "bst.hpp"
+
+#include <iterator>
+#include <string>
+
+/** the keys at the even (parity 0) or odd (parity 1) positions */
+std::vector<int> part(const std::vector<int>& keys, std::size_t parity) {
+    std::vector<int> out;
+    for (std::size_t i = parity; i < keys.size(); i += 2) {
+        out.push_back(keys[i]);
+    }
+    return out;
+}
+
+template<typename T>
+T build(const std::vector<int>& keys) {
+    T tree;
+    for (auto k : keys) {
+        tree.insert(std::pair<int,int>{k, k});
+    }
+    return tree;
+}
+
+template<typename T>
+void run(const char* name, const std::vector<int>& keys) {
+    std::size_t n = keys.size();
+    struct input {
+        const char* what;
+        std::vector<int> a;
+        std::vector<int> b;
+    };
+    std::vector<int> low(keys);
+    low.erase(std::remove_if(low.begin(), low.end(), [n](int k) {return static_cast<std::size_t>(k) >= n / 2;}), low.end());
+    std::vector<int> high(keys);
+    high.erase(std::remove_if(high.begin(), high.end(), [n](int k) {return static_cast<std::size_t>(k) < n / 2;}), high.end());
+    std::vector<input> inputs{{"interleaved", part(keys, 0), part(keys, 1)},
+                              {"disjoint", low, high},
+                              {"1% into 99%", {keys.begin(), keys.end() - n / 100}, {keys.end() - n / 100, keys.end()}}};
+
+    for (auto& in : inputs) {
+        std::string variant = std::string{name} + ", " + in.what;
+        T a = build<T>(in.a);
+        T b = build<T>(in.b);
+        timer t;
+        a.merge(std::move(b));
+        report("merge", variant.c_str(), in.b.size(), t.seconds());
+
+        T c = build<T>(in.a);
+        t.restart();
+        for (auto k : in.b) {
+            c.insert(std::pair<int,int>{k, k});
+        }
+        report("insert loop", variant.c_str(), in.b.size(), t.seconds());
+        do_not_optimize(a.size() + c.size());
+    }
+
+    T whole = build<T>(keys);
+    timer t;
+    auto upper = whole.split(static_cast<int>(n / 2));
+    report("split", name, 1, t.seconds());
+    t.restart();
+    whole.join(std::move(upper));
+    report("join", name, 1, t.seconds());
+
+    T a = build<T>(inputs[0].a);
+    T b = build<T>(inputs[0].b);
+    std::vector<int> sa(inputs[0].a);
+    std::vector<int> sb(inputs[0].b);
+    std::sort(sa.begin(), sa.end());
+    std::sort(sb.begin(), sb.end());
+    std::vector<int> out;
+    std::size_t sum = 0;
+
+    t.restart();
+    sum += set_union(a, b).size();
+    report("set_union", name, n, t.seconds());
+    t.restart();
+    out.clear();
+    std::set_union(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(out));
+    sum += out.size();
+    report("set_union", "std, sorted vectors", n, t.seconds());
+
+    t.restart();
+    sum += set_intersection(a, b).size();
+    report("intersection", name, n, t.seconds());
+    t.restart();
+    out.clear();
+    std::set_intersection(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(out));
+    sum += out.size();
+    report("intersection", "std, sorted vectors", n, t.seconds());
+
+    t.restart();
+    sum += set_difference(a, b).size();
+    report("difference", name, n, t.seconds());
+    t.restart();
+    out.clear();
+    std::set_difference(sa.begin(), sa.end(), sb.begin(), sb.end(), std::back_inserter(out));
+    sum += out.size();
+    report("difference", "std, sorted vectors", n, t.seconds());
+    do_not_optimize(sum);
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+    auto keys = random_keys(n);
+
+    run<bst<int,int>>("bst", keys);
+    run<bst<int,int,std::less<int>,avl_balance>>("bst avl", keys);
+    run<bst<int,int,std::less<int>,avl_balance,arena_alloc<>>>("bst avl arena", keys);
+    run<bst<int,int,std::less<int>,order_statistics<avl_balance>>>("bst avl order stats", keys);   // split in O(log n)
+    return 0;
+}
@@ -0,0 +1,67 @@
+// Benchmark: cost of the order_statistics augmentation
+// memory per node and insert/erase time of no_balance and avl_balance, plain and with subtree sizes,
+// then nth and rank on the augmented tree against the O(n) walk with iterators of the plain one
+// arguments: number of keys, number of nth and rank queries
+#include "bench.hpp"
+#include "bst.hpp"
+
+#include <string>
+
+template<typename BP>
+void run(const char* name, const std::vector<int>& keys, std::size_t queries) {
+    using tree_t = bst<int,int,std::less<int>,BP>;
+    std::printf("%s: %zu bytes per node\n", name, sizeof(_node<int,int,typename BP::meta,heap_alloc>));
+
+    tree_t tree;
+    timer t;
+    for (auto k : keys) {
+        tree.insert(std::pair<int,int>{k, k});
+    }
+    report("insert", name, keys.size(), t.seconds());
+
+    std::size_t n = keys.size();
+    std::size_t sum = 0;
+    std::string variant = std::string{name} + (_stores_count<typename BP::meta>::value ? ", O(log n)" : ", walk");
+    t.restart();
+    for (std::size_t q = 0; q < queries; ++q) {
+        std::size_t k = q * 7919 % n;
+        if constexpr (_stores_count<typename BP::meta>::value) {
+            sum += static_cast<std::size_t>(*tree.nth(k));
+        }
+        else {
+            sum += static_cast<std::size_t>(*std::next(tree.begin(), static_cast<std::ptrdiff_t>(k)));
+        }
+    }
+    report("nth", variant.c_str(), queries, t.seconds());
+
+    t.restart();
+    for (std::size_t q = 0; q < queries; ++q) {
+        int x = static_cast<int>(q * 7919 % n);
+        if constexpr (_stores_count<typename BP::meta>::value) {
+            sum += tree.rank(x);
+        }
+        else {
+            sum += static_cast<std::size_t>(std::distance(tree.begin(), tree.lower_bound(x)));
+        }
+    }
+    report("rank", variant.c_str(), queries, t.seconds());
+    do_not_optimize(sum);
+
+    t.restart();
+    for (auto k : keys) {
+        tree.erase(k);
+    }
+    report("erase", name, n, t.seconds());
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+    std::size_t queries = bench_size(argc, argv, 2, 100);        // the walks are O(n) each
+    auto keys = random_keys(n);
+
+    run<no_balance>("plain", keys, queries);
+    run<order_statistics<no_balance>>("order stats", keys, queries);
+    run<avl_balance>("avl", keys, queries);
+    run<order_statistics<avl_balance>>("order stats + avl", keys, queries);
+    return 0;
+}
@@ -0,0 +1,57 @@
+// Benchmark: scaling of the parallel bulk operations of bst, from 1 thread to all the hardware threads
+// bulk build from a sorted range, deep copy, full scan (for_each_parallel) and balance of a random tree
+// e.g. ./bench/parallel.x 10000000
+#include "bench.hpp"
+#include "bst.hpp"
+
+#include <atomic>
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 4000000);
+    auto keys = random_keys(n);
+
+    std::vector<std::pair<int,int>> sorted(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        sorted[i] = std::pair<int,int>{static_cast<int>(i), static_cast<int>(i)};
+    }
+    bst<int,int> random_tree;                     // unbalanced shape, for balance
+    for (auto k : keys) {
+        random_tree.insert(std::pair<int,int>{k, k});
+    }
+
+    std::vector<std::size_t> counts;
+    for (std::size_t threads = 1; threads < hardware_threads(); threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(hardware_threads());
+
+    for (auto threads : counts) {
+        char variant[32];
+        std::snprintf(variant, sizeof variant, "bst, %zu threads", threads);
+
+        bst<int,int> tree;
+        timer t;
+        tree.assign(sorted_unique, sorted.begin(), sorted.end(), threads);
+        report("build", variant, n, t.seconds());
+
+        t.restart();
+        bst<int,int> copy{tree, threads};
+        report("copy", variant, n, t.seconds());
+
+        t.restart();
+        std::atomic<long long> count{0};              // rare updates: the scan itself is measured
+        copy.for_each_parallel([&count](const int&, const int& value) {
+            if (value % 1024 == 0) {
+                count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }, threads);
+        do_not_optimize(count);
+        report("for_each", variant, n, t.seconds());
+
+        bst<int,int> unbalanced{random_tree};
+        t.restart();
+        unbalanced.balance(threads);
+        report("balance", variant, n, t.seconds());
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+// Benchmark: persistent_bst (path copying) vs bst (deep copy) for consistent snapshots
+// build, snapshot, updates while a snapshot is alive, memory per entry and per update
+#include "bench.hpp"
+#include "bst.hpp"
+#include "persistent.hpp"
+
+#include <new>
+
+/** bytes allocated and not freed yet (without the overhead of malloc), counted by the replacements below:
+ *  every block starts with a header holding its size */
+static std::size_t allocated = 0;
+
+void* operator new(std::size_t size) {
+    auto p = static_cast<std::size_t*>(std::malloc(size + 16));
+    if (!p) {
+        throw std::bad_alloc{};
+    }
+    allocated += size;
+    *p = size;
+    return reinterpret_cast<char*>(p) + 16;
+}
+
+void operator delete(void* p) noexcept {
+    if (p) {
+        auto block = reinterpret_cast<std::size_t*>(static_cast<char*>(p) - 16);
+        allocated -= *block;
+        std::free(block);
+    }
+}
+
+void operator delete(void* p, std::size_t) noexcept {operator delete(p);}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+    std::size_t updates = bench_size(argc, argv, 2, 100000);
+    auto keys = random_keys(n + updates);
+
+    bst<int,int,std::less<int>,avl_balance> tree;
+    persistent_bst<int,int> versions;
+
+    std::size_t before = allocated;
+    timer t;
+    for (std::size_t i = 0; i < n; ++i) {
+        tree.insert(std::pair<int,int>{keys[i], keys[i]});
+    }
+    report("build", "bst avl", n, t.seconds());
+    std::printf("%-14s %-28s %.1f bytes/entry\n", "memory", "bst avl", double(allocated - before) / n);
+
+    before = allocated;
+    t.restart();
+    for (std::size_t i = 0; i < n; ++i) {
+        versions.insert(std::pair<int,int>{keys[i], keys[i]});
+    }
+    report("build", "persistent_bst", n, t.seconds());
+    std::printf("%-14s %-28s %.1f bytes/entry\n", "memory", "persistent_bst", double(allocated - before) / n);
+
+    // one snapshot: deep copy of all the nodes vs sharing the root
+    before = allocated;
+    t.restart();
+    {
+        auto copy{tree};
+        report("snapshot", "bst deep copy", 1, t.seconds());
+        std::printf("%-14s %-28s %.1f bytes/snapshot\n", "memory", "bst deep copy", double(allocated - before));
+        t.restart();
+    }
+    std::size_t snapshots = 1000;
+    std::vector<persistent_bst<int,int>> kept;
+    kept.reserve(snapshots);
+    before = allocated;
+    t.restart();
+    for (std::size_t i = 0; i < snapshots; ++i) {
+        kept.push_back(versions.snapshot());
+    }
+    report("snapshot", "persistent_bst", snapshots, t.seconds());
+    kept.clear();
+
+    // updates while a snapshot is alive: half insertions of new keys, half removals
+    auto snapshot = versions.snapshot();
+    before = allocated;
+    t.restart();
+    for (std::size_t i = 0; i < updates; ++i) {
+        if (i % 2) {
+            versions.erase(keys[i]);
+        }
+        else {
+            versions.insert(std::pair<int,int>{keys[n + i], 0});
+        }
+    }
+    report("update", "persistent_bst", updates, t.seconds());
+    std::printf("%-14s %-28s %.1f bytes/update\n", "memory", "persistent_bst", double(allocated - before) / updates);
+
+    t.restart();
+    for (std::size_t i = 0; i < updates; ++i) {
+        if (i % 2) {
+            tree.erase(keys[i]);
+        }
+        else {
+            tree.insert(std::pair<int,int>{keys[n + i], 0});
+        }
+    }
+    report("update", "bst avl (no snapshot)", updates, t.seconds());
+
+    t.restart();
+    long sum = 0;
+    for (auto it = snapshot.begin(); it != snapshot.end(); ++it) {
+        sum += it.value();
+    }
+    do_not_optimize(sum);
+    report("iterate", "persistent_bst snapshot", snapshot.size(), t.seconds());
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Benchmark: SIMD key search with every instruction set supported by the CPU
+// lower_bound in a sorted array, in a node-sized array and btree lookups, against std::lower_bound
+#include "bench.hpp"
+#include "btree.hpp"
+#include "simd.hpp"
+
+/** lower_bound of all the queries in the sorted array keys, with std::lower_bound or with the kernels */
+template<typename T>
+void search(const char* operation, const std::vector<T>& keys, const std::vector<T>& queries) {
+    timer t;
+    std::size_t sum = 0;
+    for (auto q : queries) {
+        sum += static_cast<std::size_t>(std::lower_bound(keys.begin(), keys.end(), q) - keys.begin());
+    }
+    do_not_optimize(sum);
+    report(operation, "std::lower_bound", queries.size(), t.seconds());
+
+    for (int level = 0; level <= static_cast<int>(simd_supported()); ++level) {
+        simd_select(static_cast<simd_level>(level));
+        t.restart();
+        sum = 0;
+        for (auto q : queries) {
+            sum += simd_lower_bound(keys.data(), keys.size(), q);
+        }
+        do_not_optimize(sum);
+        report(operation, simd_name(simd_active()), queries.size(), t.seconds());
+    }
+}
+
+/** sorted keys 0, 2, 4, ... and random queries among them and between them */
+template<typename T>
+void arrays(const char* type, std::size_t size, std::size_t n) {
+    std::vector<T> keys(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        keys[i] = static_cast<T>(2 * i);
+    }
+    std::vector<T> queries(n);
+    std::mt19937 gen{7};
+    for (auto& q : queries) {
+        q = static_cast<T>(gen() % (2 * size));
+    }
+    char operation[32];
+    std::snprintf(operation, sizeof operation, "%s[%zu]", type, size);
+    search(operation, keys, queries);
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+
+    arrays<int>("int", 32, n);
+    arrays<int>("int", n, n);
+    arrays<double>("double", 16, n);
+    arrays<double>("double", n, n);
+
+    auto keys = random_keys(n);
+    btree<int,int> tree;
+    for (auto k : keys) {
+        tree.insert(std::pair<int,int>{k, k});
+    }
+    auto queries = random_keys(n, 7);
+    for (int level = 0; level <= static_cast<int>(simd_supported()); ++level) {
+        simd_select(static_cast<simd_level>(level));
+        timer t;
+        long sum = 0;
+        for (auto k : queries) {
+            sum += tree.find(k).value();
+        }
+        do_not_optimize(sum);
+        report("btree find", simd_name(simd_active()), n, t.seconds());
+    }
+    return 0;
+}
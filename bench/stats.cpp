@@ -0,0 +1,71 @@
+// Benchmark: instrumentation of bst
+// ingest of sorted and random keys into a no_balance tree, with and without auto_balance, followed by
+// n lookups; cost of stats() (one walk of the tree) and of height() for no_balance and avl_balance
+// the counters are compiled only with BST_STATS: to measure their cost build this program once more with
+// g++ -I src -O3 -DNDEBUG -std=c++17 -pthread -DBST_STATS bench/stats.cpp -o bench/stats_counted.x
+#include "bench.hpp"
+#include "bst.hpp"
+
+#include <string>
+
+template<typename T>
+void run(const char* keys_name, const std::vector<int>& keys, double threshold) {
+    std::string variant = std::string{keys_name} + (threshold > 0 ? ", auto_balance" : ", plain");
+    T tree;
+    tree.auto_balance(threshold);
+    timer t;
+    for (auto k : keys) {
+        tree.insert(std::pair<int,int>{k, k});
+    }
+    report("insert", variant.c_str(), keys.size(), t.seconds());
+
+    t.restart();
+    std::size_t found = 0;
+    for (auto k : keys) {
+        found += tree.contains(k);
+    }
+    do_not_optimize(found);
+    report("find", variant.c_str(), keys.size(), t.seconds());
+
+    t.restart();
+    auto s = tree.stats();
+    report("stats", variant.c_str(), keys.size(), t.seconds());
+    std::printf("    height %zu, average depth %.1f, auto balances %llu, comparisons per find %.1f\n", s.height,
+                s.average_depth, static_cast<unsigned long long>(s.auto_balances),
+                s.finds ? static_cast<double>(s.find_comparisons) / static_cast<double>(s.finds) : 0.0);
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench_size(argc, argv, 1, 1000000);
+    std::printf("counters %s\n", bst_stats_enabled ? "on (BST_STATS)" : "off");
+
+    std::vector<int> sorted(std::min<std::size_t>(n, 20000));      // no_balance without auto_balance is a list
+    std::iota(sorted.begin(), sorted.end(), 0);
+    auto random = random_keys(n);
+
+    run<bst<int,int>>("sorted", sorted, 0);
+    run<bst<int,int>>("sorted", sorted, 3);
+    {
+        bst<int,int> warm_up;                     // all the measured trees reuse a fragmented heap
+        for (auto k : random) {
+            warm_up.insert(std::pair<int,int>{k, k});
+        }
+    }
+    run<bst<int,int>>("random", random, 0);
+    run<bst<int,int>>("random", random, 3);
+
+    bst<int,int> plain;
+    bst<int,int,std::less<int>,avl_balance> avl;
+    for (auto k : random) {
+        plain.insert(std::pair<int,int>{k, k});
+        avl.insert(std::pair<int,int>{k, k});
+    }
+    timer t;
+    auto h = plain.height();
+    report("height", "no_balance, O(n)", n, t.seconds());
+    t.restart();
+    h += avl.height();
+    report("height", "avl_balance, O(1)", 1, t.seconds());
+    do_not_optimize(h);
+    return 0;
+}
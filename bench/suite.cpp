@@ -0,0 +1,190 @@
+// Benchmark suite: every operation of bst (no_balance, avl_balance, avl_balance + arena_alloc) vs std::map
+// and std::unordered_map, for random, sorted and skewed keys and sizes from 1K (x10) up to the first argument
+// the results are printed and appended to a CSV file, to compare versions with bench/compare.py
+// arguments: largest number of keys (e.g. 100000000), CSV file, label of the version
+// e.g. ./bench/suite.x 1000000 results.csv before
+#include "bench.hpp"
+#include "bst.hpp"
+
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <type_traits>
+
+/** no_balance with sorted keys is a list: above this size its insertions would take hours */
+constexpr std::size_t degenerate_limit = 20000;
+
+/** output of the suite: the printed table and the CSV file */
+struct results {
+    std::FILE* csv;
+    std::string label;
+
+    void add(const char* structure, const char* keys, const char* operation, std::size_t n, double seconds) {
+        char variant[48];
+        std::snprintf(variant, sizeof variant, "%s, %s", structure, keys);
+        report(operation, variant, n, seconds);
+        std::fprintf(csv, "%s,%s,%s,%s,%zu,%.9f,%.3f\n", label.c_str(), structure, keys, operation, n,
+                     seconds, n ? seconds * 1e9 / n : 0.0);
+    }
+};
+
+template<typename T>
+struct is_bst : std::false_type {};
+
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+struct is_bst<bst<k_t, v_t, OP, BP, AP>> : std::true_type {};
+
+/** sum of the values, visiting the whole container */
+template<typename T>
+long long scan(const T& c) {
+    long long sum = 0;
+    if constexpr (is_bst<T>::value) {
+        for (auto it = c.begin(); it != c.end(); ++it) {
+            sum += it.value();
+        }
+    }
+    else {
+        for (auto& p : c) {
+            sum += p.second;
+        }
+    }
+    return sum;
+}
+
+/**
+ * function measure
+ * runs setup (not timed) and then op (timed) reps times
+ * @return returns the shortest time of op
+ */
+template<typename Setup, typename Op>
+double measure(std::size_t reps, Setup&& setup, Op&& op) {
+    double best = 1e300;
+    for (std::size_t r = 0; r < reps; ++r) {
+        setup();
+        timer t;
+        op();
+        best = std::min(best, t.seconds());
+    }
+    return best;
+}
+
+/**
+ * function run
+ * all the operations on a container of type T
+ * @param keys --> keys of the insertions and of the lookups, in order (with repetitions for skewed keys)
+ * @param unique --> the distinct keys, in order of first appearance (erase)
+ */
+template<typename T>
+void run(const char* structure, const char* keys_name, const std::vector<int>& keys,
+         const std::vector<int>& unique, results& out) {
+    std::size_t n = keys.size();
+    std::size_t reps = std::max<std::size_t>(1, 100000 / n);       // small sizes are repeated
+    T c;
+    auto reset = [&c] {c = T{};};
+
+    out.add(structure, keys_name, "insert", n, measure(reps, reset, [&] {
+        for (auto k : keys) {
+            c.insert(std::pair<int,int>{k, k});
+        }
+    }));
+    out.add(structure, keys_name, "emplace", n, measure(reps, reset, [&] {
+        for (auto k : keys) {
+            c.emplace(k, k);
+        }
+    }));
+
+    auto nothing = [] {};
+    out.add(structure, keys_name, "find", n, measure(reps, nothing, [&] {
+        std::size_t found = 0;
+        for (auto k : keys) {
+            found += c.find(k) != c.end();
+        }
+        do_not_optimize(found);
+    }));
+    out.add(structure, keys_name, "operator[]", n, measure(reps, nothing, [&] {
+        for (auto k : keys) {
+            c[k] += 1;
+        }
+    }));
+    out.add(structure, keys_name, "iterate", n, measure(reps, nothing, [&] {
+        auto sum = scan(c);
+        do_not_optimize(sum);
+    }));
+
+    T copy;
+    out.add(structure, keys_name, "copy", n, measure(reps, [&] {copy = T{};}, [&] {
+        T tmp{c};
+        copy = std::move(tmp);
+    }));
+    out.add(structure, keys_name, "move", n, measure(reps, nothing, [&] {
+        T tmp{std::move(copy)};
+        copy = std::move(tmp);
+    }));
+    out.add(structure, keys_name, "clear", n, measure(reps, [&] {copy = c;}, [&] {copy.clear();}));
+
+    if constexpr (is_bst<T>::value) {
+        out.add(structure, keys_name, "balance", n, measure(reps, [&] {copy = c;}, [&] {copy.balance();}));
+    }
+
+    out.add(structure, keys_name, "erase", unique.size(), measure(reps, [&] {copy = c;}, [&] {
+        for (auto k : unique) {
+            copy.erase(k);
+        }
+    }));
+}
+
+int main(int argc, char** argv) {
+    std::size_t max_n = bench_size(argc, argv, 1, 1000000);
+    const char* csv_path = argc > 2 ? argv[2] : "bench_results.csv";
+    results out{std::fopen(csv_path, "a"), argc > 3 ? argv[3] : "current"};
+    if (!out.csv) {
+        std::perror(csv_path);
+        return 1;
+    }
+    std::fseek(out.csv, 0, SEEK_END);
+    if (std::ftell(out.csv) == 0) {                        // new file
+        std::fprintf(out.csv, "label,structure,keys,operation,n,seconds,ns_per_op\n");
+    }
+
+    for (std::size_t n = 1000; n <= max_n; n *= 10) {
+        std::vector<int> sorted(n);
+        std::iota(sorted.begin(), sorted.end(), 0);
+        auto random = random_keys(n);
+
+        // skewed: key floor(n u^3) for u uniform in [0, 1), so that the small keys are hot
+        // (about half of the keys are in the first tenth of the range)
+        std::vector<int> skewed(n);
+        std::mt19937 gen{7};
+        std::uniform_real_distribution<double> u{0.0, 1.0};
+        for (auto& k : skewed) {
+            double x = u(gen);
+            k = static_cast<int>(static_cast<double>(n) * x * x * x);
+        }
+        std::vector<int> skewed_unique;
+        std::vector<bool> seen(n);
+        for (auto k : skewed) {
+            if (!seen[static_cast<std::size_t>(k)]) {
+                seen[static_cast<std::size_t>(k)] = true;
+                skewed_unique.push_back(k);
+            }
+        }
+
+        struct distribution {
+            const char* name;
+            const std::vector<int>& keys;
+            const std::vector<int>& unique;
+        };
+        for (auto& d : {distribution{"random", random, random}, distribution{"sorted", sorted, sorted},
+                        distribution{"skewed", skewed, skewed_unique}}) {
+            if (n <= degenerate_limit || &d.keys != &sorted) {
+                run<bst<int,int>>("bst", d.name, d.keys, d.unique, out);
+            }
+            run<bst<int,int,std::less<int>,avl_balance>>("bst avl", d.name, d.keys, d.unique, out);
+            run<bst<int,int,std::less<int>,avl_balance,arena_alloc<>>>("bst avl arena", d.name, d.keys, d.unique, out);
+            run<std::map<int,int>>("std::map", d.name, d.keys, d.unique, out);
+            run<std::unordered_map<int,int>>("std::unordered_map", d.name, d.keys, d.unique, out);
+        }
+    }
+    std::fclose(out.csv);
+    return 0;
+}
@@ -2,8 +2,53 @@
 #include "src/bst.hpp"
 #include "src/iterator.hpp"
 #include "src/node.hpp"
+#include "src/btree.hpp"
+#include "src/compact.hpp"
+#include "src/simd.hpp"
+#include "src/concurrent.hpp"
+#include "src/persistent.hpp"
 
 #include <iostream>
+#include <atomic>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * checks the SIMD search kernels against std::lower_bound and std::upper_bound,
+ * with every instruction set supported by the CPU
+ * throws std::logic_error at the first mismatch
+ */
+template<typename T>
+void check_simd(const char* type) {
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<int> value{-1000, 1000};
+    for (int level = 0; level <= static_cast<int>(simd_supported()); ++level) {
+        simd_select(static_cast<simd_level>(level));
+        for (std::size_t n : {0, 1, 3, 8, 31, 32, 33, 100, 1000}) {
+            std::vector<T> keys(n);
+            for (auto& k : keys) {
+                k = static_cast<T>(value(gen));
+            }
+            std::sort(keys.begin(), keys.end());
+            for (int x = -1001; x <= 1001; x += 7) {
+                T key = static_cast<T>(x);
+                auto lower = static_cast<std::size_t>(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+                auto upper = static_cast<std::size_t>(std::upper_bound(keys.begin(), keys.end(), key) - keys.begin());
+                if (simd_lower_bound(keys.data(), n, key) != lower || simd_upper_bound(keys.data(), n, key) != upper) {
+                    throw std::logic_error(std::string{"SIMD search of "} + type + " keys with " +
+                                           simd_name(static_cast<simd_level>(level)) + " differs from std::lower_bound");
+                }
+            }
+        }
+    }
+    simd_select(simd_supported());
+}
 
 int main() {
 
@@ -62,6 +107,9 @@ int main() {
         emplace_tree.emplace(2,88);
         emplace_tree.emplace(20,88);
         std::cout << "Tree after adding nodes (2,88) and (20,88) by emplace_back: \n" << emplace_tree << std::endl;
+        auto hint = emplace_tree.emplace_hint(emplace_tree.end(), 25, 88);    // right after the last node
+        emplace_tree.insert(hint, std::pair<int,int>{30,88});                  // right after the hint
+        std::cout << "Tree after adding nodes (25,88) and (30,88) with hints: \n" << emplace_tree << std::endl;
          
 
         // Subscripting operator
@@ -73,6 +121,30 @@ int main() {
         std::cout <<"subsc_tree [30]: " << subsc_tree[30] << "\n";
         std::cout <<"subsc_tree [-5]: " << subsc_tree[-5] << std::endl;
 
+        // Try_emplace function
+        std::cout << "\n***** Test on Try_emplace function*****" << "\n\n";
+        auto inserted = subsc_tree.try_emplace(40, 77);
+        auto not_inserted = subsc_tree.try_emplace(3, 77);
+        std::cout << "try_emplace(40,77): inserted = " << inserted.second << ", value = " << inserted.first.value() << "\n";
+        std::cout << "try_emplace(3,77): inserted = " << not_inserted.second << ", value = " << not_inserted.first.value() << std::endl;
+
+        // Range queries
+        std::cout << "\n***** Test on Range queries *****" << "\n\n";
+        std::cout << tree;
+        std::cout << "lower_bound(5): " << *tree.lower_bound(5) << ", upper_bound(7): " << *tree.upper_bound(7) << "\n";
+        auto eq = tree.equal_range(10);
+        std::cout << "equal_range(10): [" << *eq.first << ", " << *eq.second << ")\n";
+        std::cout << "keys in [3, 13): ";
+        for(auto& key : tree.range(3, 13)){
+            std::cout << key << " ";
+        }
+        std::cout << "\nkeys in reverse order: ";
+        for(auto it = tree.rbegin(); it != tree.rend(); ++it){
+            std::cout << *it << " ";
+        }
+        std::cout << "\nlast key: " << *std::prev(tree.end());
+        std::cout << std::endl;
+
         // Put-to operator
         std::cout << "\n****** Test on Put-to operstor ******" << "\n\n";
         std::cout << tree << std::endl;
@@ -81,7 +153,247 @@ int main() {
         std::cout <<"\n****** Test on Balance function ******" << "\n\n";
         tree.balance();
         std::cout << "After balance: \n" << tree << std::endl;
-  
+
+        // AVL balancing policy
+        std::cout <<"\n****** Test on AVL balancing policy ******" << "\n\n";
+        bst<int,int,std::less<int>,avl_balance> avl_tree;
+        for(int i = 1; i <= 10; ++i){
+            avl_tree.insert(std::pair<int,int>{i,i*i});     // sorted keys: the tree keeps rotating
+        }
+        std::cout << "After inserting 1..10 in order: \n" << avl_tree << "\n";
+        avl_tree.erase(4);
+        avl_tree.erase(1);
+        std::cout << "After erasing nodes 4 and 1: \n" << avl_tree << std::endl;
+
+        // Bulk construction from a range
+        std::cout <<"\n****** Test on Bulk construction ******" << "\n\n";
+        std::vector<std::pair<int,int>> sorted_pairs{{1,10},{2,20},{3,30},{5,50},{8,80}};
+        bst<int,int> sorted_tree{sorted_unique, sorted_pairs.begin(), sorted_pairs.end()};
+        std::cout << "Tree built from a sorted range: \n" << sorted_tree << "\n";
+        std::vector<std::pair<int,int>> unsorted_pairs{{9,1},{4,1},{7,1},{4,2},{1,1}};
+        bst<int,int,std::less<int>,avl_balance> unsorted_tree{unsorted_pairs.begin(), unsorted_pairs.end()};
+        std::cout << "Tree built from an unsorted range: \n" << unsorted_tree;
+        std::cout << "value of key 4: " << unsorted_tree.find(4).value() << std::endl;
+
+        // Heterogeneous lookup
+        std::cout << "\n****** Test on Heterogeneous lookup ******" << "\n\n";
+        bst<std::string,int,std::less<>> words;          // transparent comparison operator
+        words.try_emplace("pear", 3);
+        words.try_emplace("apple", 1);
+        words.try_emplace("fig", 2);
+        std::string_view key{"fig"};
+        std::cout << words;
+        std::cout << "find(string_view \"fig\"): " << words.find(key).value() << "\n";
+        std::cout << "contains(\"apple\"): " << words.contains("apple") << ", contains(\"kiwi\"): " << words.contains("kiwi") << "\n";
+        words.erase("pear");
+        std::cout << "After erasing \"pear\": \n" << words << std::endl;
+
+        // B+tree backend
+        std::cout << "\n****** Test on B+tree backend ******" << "\n\n";
+        btree<int,int,std::less<int>,64> b_tree;         // small nodes (5 keys per leaf), to have a few levels
+        for(int i = 20; i > 0; --i){
+            b_tree.insert(std::pair<int,int>{i*3 % 41, i});
+        }
+        std::cout << b_tree;
+        b_tree[100] = 7;
+        b_tree.erase(3);
+        std::cout << "After b_tree[100] = 7 and erasing node 3: \n" << b_tree;
+        std::cout << "size: " << b_tree.size() << ", height: " << b_tree.height() << ", value of key 9: " << b_tree.find(9).value() << std::endl;
+
+        // Compact tree
+        std::cout << "\n****** Test on Compact tree ******" << "\n\n";
+        compact_bst<int,int> c_tree;
+        for(int i = 1; i <= 20; ++i){
+            c_tree.insert(std::pair<int,int>{i*7 % 23, i});
+        }
+        c_tree.erase(7);
+        c_tree[50] = 5;                                   // reuses the node of key 7
+        std::cout << c_tree << "size: " << c_tree.size() << ", height: " << c_tree.height() << ", bytes per node: "
+                  << sizeof(compact_bst<int,int>::node) << ", last key: " << *std::prev(c_tree.end()) << std::endl;
+
+        // Batched lookups
+        std::cout << "\n****** Test on Batched lookups ******" << "\n\n";
+        std::vector<int> batch_keys{13, 2, 7, 40, 1};
+        std::vector<bool> present;
+        tree.contains_batch(batch_keys.begin(), batch_keys.end(), std::back_inserter(present));
+        std::vector<decltype(tree.find(0))> found;
+        tree.find_batch(batch_keys.begin(), batch_keys.end(), std::back_inserter(found));
+        for(std::size_t i = 0; i < batch_keys.size(); ++i){
+            std::cout << "key " << batch_keys[i] << ": " << (present[i] ? "found" : "not found");
+            std::cout << (found[i] != tree.end() ? ", value " + std::to_string(found[i].value()) : std::string{}) << "\n";
+        }
+        std::cout << std::endl;
+
+        // Frozen snapshot
+        std::cout << "\n****** Test on Frozen snapshot ******" << "\n\n";
+        auto frozen = tree.freeze();
+        tree.insert(std::pair<int,int>{5,99});                 // the snapshot does not change
+        std::cout << "Snapshot of the tree: \n" << frozen;
+        std::cout << "Tree after inserting node 5: \n" << tree;
+        std::cout << "contains(5): " << frozen.contains(5) << ", lower_bound(5): " << *frozen.lower_bound(5)
+                  << ", value of key 13: " << frozen.find(13).value() << std::endl;
+
+        // Concurrent tree
+        std::cout << "\n****** Test on Concurrent tree ******" << "\n\n";
+        concurrent_bst<int,int> shared_tree;
+        for(int i = 1; i <= 7; ++i){
+            shared_tree.insert(std::pair<int,int>{(i * 5) % 8, i});
+        }
+        shared_tree.erase(5);                                 // the path from the root is copied, rebalanced and published
+        std::cout << shared_tree;
+        auto shared_value = shared_tree.find(6);
+        std::cout << "find(6): " << (shared_value ? *shared_value : -1) << ", find(5) has a value: " << shared_tree.find(5).has_value()
+                  << ", size: " << shared_tree.size() << ", height: " << shared_tree.height() << std::endl;
+
+        // Persistent tree
+        std::cout << "\n****** Test on Persistent tree ******" << "\n\n";
+        persistent_bst<int,int> version;
+        for(int i = 1; i <= 6; ++i){
+            version.insert(std::pair<int,int>{i, i*10});
+        }
+        auto old_version = version.snapshot();                // O(1): the nodes are shared
+        version.erase(3);
+        version.insert_or_assign(4, 0);
+        std::cout << "Snapshot: \n" << old_version << "Tree after erasing node 3 and assigning 0 to key 4: \n" << version;
+        std::cout << "value of key 4 in the snapshot: " << old_version.find(4).value()
+                  << ", in the tree: " << version.find(4).value() << std::endl;
+
+        // Parallel bulk operations
+        std::cout << "\n****** Test on Parallel bulk operations ******" << "\n\n";
+        std::vector<std::pair<int,int>> ordered_pairs;
+        for(int i = 0; i < 100000; ++i){
+            ordered_pairs.emplace_back(i, 2*i);
+        }
+        bst<int,int> built;
+        built.assign(sorted_unique, ordered_pairs.begin(), ordered_pairs.end(), 4);    // 4 threads
+        bst<int,int> built_copy{built, 4};
+        std::atomic<long long> sum{0};
+        built_copy.for_each_parallel([&sum](const int&, const int& value) {sum += value;}, 4);
+        std::cout << "built with 4 threads: " << std::distance(built.begin(), built.end()) << " nodes, copy equal: "
+                  << std::equal(built.begin(), built.end(), built_copy.begin()) << ", sum of the values: " << sum << std::endl;
+        bst<int,int> vine;
+        for(auto& x : ordered_pairs){
+            vine.insert(vine.end(), x);               // increasing keys: a list
+        }
+        vine.balance(4);
+        std::cout << "list of 100000 nodes balanced with 4 threads, in order: "
+                  << std::equal(vine.begin(), vine.end(), built.begin()) << std::endl;
+
+        // Binary files
+        std::cout << "\n****** Test on Binary files ******" << "\n\n";
+        built.save("tree.bin");
+        bst<int,int> loaded;
+        loaded.load("tree.bin");                         // bulk build, O(n)
+        auto mapped = frozen_bst<int,int>::load("tree.bin");   // the file is searched in place
+        std::cout << "round trip: " << std::distance(loaded.begin(), loaded.end()) << " nodes, equal: "
+                  << std::equal(built.begin(), built.end(), loaded.begin(), loaded.end())
+                  << ", mapped snapshot equal: " << std::equal(built.begin(), built.end(), mapped.begin(), mapped.end())
+                  << ", value of key 777 in the mapped snapshot: " << mapped.find(777).value() << std::endl;
+        bst<std::string,int,std::less<>> words_copy;
+        words.save("words.bin");                          // std::string keys: records written by serializer<std::string>
+        words_copy.load("words.bin");
+        std::cout << "Tree of strings read back: \n" << words_copy;
+        std::remove("tree.bin");
+        std::remove("words.bin");
+
+        // Streaming records
+        std::cout << "\n****** Test on Streaming records ******" << "\n\n";
+        bst<int,double> prices;
+        prices.insert(std::pair<int,double>{3, 0.1});
+        prices.insert(std::pair<int,double>{1, 2.5});
+        prices.insert(std::pair<int,double>{2, 1e-7});
+        prices.export_records(ostream_sink{std::cout}, record_format::csv);
+        std::string records;
+        prices.export_records(string_sink{records}, record_format::binary);
+        bst<int,double> prices_copy;
+        prices_copy.import_records(string_source{records}, record_format::binary);
+        std::cout << "binary records: " << records.size() << " bytes, read back: \n" << prices_copy;
+        bst<std::string,std::string> notes;
+        notes.insert(std::pair<std::string,std::string>{"a b", "v1"});
+        notes.insert(std::pair<std::string,std::string>{"multi", "line1\nline2"});
+        notes.insert(std::pair<std::string,std::string>{"back\\slash", "x y\\n"});
+        std::string text;
+        notes.export_records(string_sink{text}, record_format::text);      // spaces of the keys and new lines are escaped
+        bst<std::string,std::string> notes_copy;
+        notes_copy.import_records(string_source{text}, record_format::text);
+        bool same = std::distance(notes_copy.begin(), notes_copy.end()) == 3;
+        for (auto it = notes.begin(); same && it != notes.end(); ++it) {
+            auto found = notes_copy.find(*it);
+            same = found != notes_copy.end() && found.value() == it.value();
+        }
+        std::cout << "text records of strings with spaces and new lines read back equal: " << same << std::endl;
+
+        // Instrumentation
+        std::cout << "\n****** Test on Instrumentation ******" << "\n\n";
+        bst<int,int> chain;                               // sorted keys: a list
+        bst<int,int> watched;
+        watched.auto_balance(3);                          // balanced again when the average depth grows too much
+        for (int i = 0; i < 1000; ++i) {
+            chain.insert(std::pair<int,int>{i, i});
+            watched.insert(std::pair<int,int>{i, i});
+        }
+        std::cout << "sorted insertions, size: " << chain.size() << ", height: " << chain.height()
+                  << ", average depth: " << chain.stats().average_depth << std::endl;
+        auto watched_stats = watched.stats();
+        std::cout << "with auto_balance(3), height: " << watched_stats.height << ", average depth: "
+                  << watched_stats.average_depth << ", balances: " << watched_stats.auto_balances << std::endl;
+        chain.balance();
+        std::cout << "after balance: \n" << chain.stats();     // counters are 0 unless compiled with -DBST_STATS
+
+        // Order statistics
+        std::cout << "\n****** Test on Order statistics ******" << "\n\n";
+        bst<int,int,std::less<int>,order_statistics<avl_balance>> ranked;
+        for (int i = 0; i < 100; ++i) {
+            ranked.insert(std::pair<int,int>{(i * 37) % 100 * 10, i});    // keys 0, 10, ..., 990
+        }
+        ranked.erase(500);
+        std::cout << "10th key: " << *ranked.nth(10) << ", median: " << *ranked.nth(ranked.size() / 2)
+                  << ", rank of 505: " << ranked.rank(505) << ", keys in [200, 700): " << ranked.count_range(200, 700)
+                  << ", distance from 250 to end: " << std::distance(ranked.lower_bound(250), ranked.end()) << std::endl;
+
+        // Merge, split and join
+        std::cout << "\n****** Test on Merge, split and join ******" << "\n\n";
+        bst<int,int,std::less<int>,avl_balance> evens;
+        bst<int,int,std::less<int>,avl_balance> odds;
+        bst<int,int,std::less<int>,avl_balance> threes;
+        for (int i = 0; i < 20; ++i) {
+            evens.insert(std::pair<int,int>{2 * i, i});
+            odds.insert(std::pair<int,int>{2 * i + 1, i});
+            threes.insert(std::pair<int,int>{3 * i, i});
+        }
+        std::cout << "union: " << set_union(evens, odds) << "intersection with the multiples of 3: "
+                  << set_intersection(evens, threes) << "difference: " << set_difference(evens, threes);
+        evens.merge(std::move(odds));                     // the nodes of odds are relinked, odds is left empty
+        std::cout << "after merge: " << evens.size() << " keys, height " << evens.height() << ", odds: "
+                  << odds.size() << " keys" << std::endl;
+        auto upper = evens.split(25);
+        std::cout << "split at 25: " << evens << "and: " << upper;
+        evens.join(std::move(upper));
+        std::cout << "joined again: " << evens.size() << " keys, height " << evens.height() << std::endl;
+
+        // Node handles
+        std::cout << "\n****** Test on Node handles ******" << "\n\n";
+        bst<int,std::string> queue;
+        bst<int,std::string> done;
+        queue.emplace(1, "parse");
+        queue.emplace(2, "build");
+        queue.emplace(3, "test");
+        auto task = queue.extract(2);                     // the node leaves the tree, nothing is freed
+        done.insert(std::move(task));                     // and is linked in the other one
+        auto retry = queue.extract(queue.begin());
+        retry.key() = 10;                                 // a new key, same node
+        queue.insert(std::move(retry));
+        std::cout << "queue: " << queue << "done: " << done << "value of 10: " << queue.find(10).value()
+                  << ", extract(7) empty: " << queue.extract(7).empty() << std::endl;
+
+        // SIMD key search
+        std::cout << "\n****** Test on SIMD key search ******" << "\n\n";
+        check_simd<int>("int");
+        check_simd<long long>("long long");
+        check_simd<float>("float");
+        check_simd<double>("double");
+        std::cout << "SIMD kernels agree with std::lower_bound and std::upper_bound" << std::endl;
+
         // Clear function
         std::cout << "\n****** Test on Clear function ******" << "\n\n";
         //bst<int,int> clear_tree {tree};
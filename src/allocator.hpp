@@ -0,0 +1,333 @@
+#ifndef _bst_allocator
+#define _bst_allocator
+
+#include <cstddef>  //std::size_t
+#include <cstdint>  //std::uintptr_t
+#include <new>      //placement new, std::align_val_t
+#include <utility>  //std::forward, std::exchange
+#include <memory>   //std::default_delete
+
+/**
+ * ********* Allocator policies *********
+ *
+ * an allocator policy is the fifth template argument of bst (after the balancing policy)
+ * it decides where the nodes live and how they are freed
+ *
+ * every policy provides
+ * deleter<N>   --> deleter of the unique pointers linking the nodes of type N
+ * pool<N>      --> object owned by the tree that creates the nodes (function make)
+ * bulk_release --> true if the pool can free all its nodes at once, without visiting them
+ * concurrent_make --> true if several threads can create nodes with the same pool at the same time
+ *
+ * and, for the operations moving nodes between trees (merge, split, join of bst), the functions of pool
+ * same  --> true if the nodes of the two pools can be linked in one tree as they are
+ * owns  --> true if a node can be linked in the tree of the pool as it is (insert of a node handle)
+ * adopt --> makes the nodes of another pool nodes of this one, returns false if it cannot
+ * share --> makes this pool create its nodes where another pool does (the two trees hold nodes of both)
+ */
+
+
+/**
+ * ********* heap_alloc *********
+ *
+ * every node is allocated with new and freed with delete (default)
+ */
+struct heap_alloc {
+
+    template<typename N>
+    using deleter = std::default_delete<N>;
+
+    static constexpr bool bulk_release = false;
+
+    static constexpr bool concurrent_make = true;     // new is thread safe
+
+    template<typename N>
+    class pool {
+     public:
+        /** allocates and constructs a node */
+        template<typename... Types>
+        N* make(Types&&... args) {return new N(std::forward<Types>(args)...);}
+
+        /** nothing to prepare: every node is a separate allocation */
+        void reserve(std::size_t) noexcept {}
+
+        void release_all() noexcept {}
+
+        /** all the nodes are on the heap */
+        bool same(const pool&) const noexcept {return true;}
+        bool owns(const N*) const noexcept {return true;}
+        bool adopt(pool&) noexcept {return true;}
+        void share(pool&) noexcept {}
+    };
+};
+
+
+/**
+ * ********* arena_alloc *********
+ *
+ * the nodes are stored in chunks of ChunkBytes bytes, aligned to their size,
+ * so the chunk (and the pool that owns it) is found by masking the address of a node:
+ * the unique pointers keep a stateless deleter and the size of a raw pointer
+ *
+ * new nodes are taken from the free list (erased nodes) or from the end of the last chunk;
+ * all the chunks are freed together when the pool is released, O(chunks)
+ *
+ * after a split the two trees share the state of the pool (counted in _owners): then, as long as
+ * some nodes of the state are not in the tree being cleared, the nodes are freed one by one
+ *
+ * @param ChunkBytes --> size (and alignment) of a chunk, a power of two
+ */
+template<std::size_t ChunkBytes = (std::size_t{1} << 16)>
+struct arena_alloc {
+
+    static_assert((ChunkBytes & (ChunkBytes - 1)) == 0, "ChunkBytes must be a power of two");
+
+    struct _state;
+
+    /** header at the beginning of every chunk */
+    struct _chunk {
+        _state* _owner;
+        _chunk* _next;
+    };
+
+    /**
+     * state of a pool, allocated separately so that it does not move with the tree
+     * it is deleted by the last pool using it, or by the last node freed after the pools are gone
+     */
+    struct _state {
+        _chunk* _chunks{nullptr};     // chunks in use, the last one first
+        _chunk* _spare{nullptr};      // chunks reserved but not used yet
+        void* _free_list{nullptr};    // erased nodes, linked through their own storage
+        char* _bump{nullptr};         // next free slot of the last chunk
+        char* _bump_end{nullptr};
+        std::size_t _live{0};         // constructed nodes
+        std::size_t _owners{1};       // pools using the state: at 0 the last node deletes it
+
+        ~_state() {
+            for (auto list : {_chunks, _spare}) {
+                while (list) {
+                    auto next = list->_next;
+                    ::operator delete(static_cast<void*>(list), std::align_val_t{ChunkBytes});
+                    list = next;
+                }
+            }
+        }
+    };
+
+    /** returns the header of the chunk that contains p */
+    static _chunk* _chunk_of(const void* p) noexcept {
+        return reinterpret_cast<_chunk*>(reinterpret_cast<std::uintptr_t>(p) & ~(ChunkBytes - 1));
+    }
+
+    static constexpr bool bulk_release = true;
+
+    static constexpr bool concurrent_make = false;    // the free list and the chunks are not locked
+
+    /** destroys the node and puts its storage in the free list of its pool */
+    template<typename N>
+    struct deleter {
+        void operator()(N* p) const noexcept {
+            _state* s = _chunk_of(p)->_owner;
+            p->~N();
+            s->_free_list = ::new (static_cast<void*>(p)) void*{s->_free_list};
+            if (--s->_live == 0 && s->_owners == 0) {
+                delete s;
+            }
+        }
+    };
+
+    template<typename N>
+    class pool {
+
+        /** offset of the first node in a chunk, after the header */
+        static constexpr std::size_t _first = (sizeof(_chunk) + alignof(N) - 1) / alignof(N) * alignof(N);
+        /** number of nodes in a chunk */
+        static constexpr std::size_t _per_chunk = (ChunkBytes - _first) / sizeof(N);
+        static_assert(_per_chunk > 0, "ChunkBytes is too small for the node type");
+
+        _state* _s{nullptr};
+
+        /** makes the next chunk (a spare one if any) the current one */
+        void _next_chunk() {
+            _chunk* c = _s->_spare;
+            if (c) {
+                _s->_spare = c->_next;
+                c->_next = _s->_chunks;
+            }
+            else {
+                void* mem = ::operator new(ChunkBytes, std::align_val_t{ChunkBytes});
+                c = ::new (mem) _chunk{_s, _s->_chunks};
+            }
+            _s->_chunks = c;
+            _s->_bump = reinterpret_cast<char*>(c) + _first;
+            _s->_bump_end = _s->_bump + _per_chunk * sizeof(N);
+        }
+
+        /** returns uninitialized storage for one node */
+        void* _slot() {
+            _state_of();
+            if (_s->_free_list) {
+                void* p = _s->_free_list;
+                _s->_free_list = *static_cast<void**>(p);
+                return p;
+            }
+            if (_s->_bump == _s->_bump_end) {
+                _next_chunk();
+            }
+            void* p = _s->_bump;
+            _s->_bump += sizeof(N);
+            return p;
+        }
+
+        /** gives up the state: deleted now if no other pool uses it and no node is alive,
+         * by the last node otherwise */
+        void _drop() noexcept {
+            if (_s) {
+                if (--_s->_owners == 0 && _s->_live == 0) {
+                    delete _s;
+                }
+                _s = nullptr;
+            }
+        }
+
+        /** returns the state, created if needed */
+        _state* _state_of() {
+            if (!_s) {
+                _s = new _state{};
+            }
+            return _s;
+        }
+
+     public:
+        /** default ctor: no chunk is allocated before the first node */
+        pool() noexcept = default;
+
+        /** move ctor: the chunks (and the nodes in them) change owner */
+        pool(pool&& x) noexcept : _s{std::exchange(x._s, nullptr)} {}
+
+        /** move assignment */
+        pool& operator=(pool&& x) noexcept {
+            if (this != &x) {
+                _drop();
+                _s = std::exchange(x._s, nullptr);
+            }
+            return *this;
+        }
+
+        pool(const pool&) = delete;
+        pool& operator=(const pool&) = delete;
+
+        /** dtor */
+        ~pool() {_drop();}
+
+        /** constructs a node in the pool */
+        template<typename... Types>
+        N* make(Types&&... args) {
+            void* p = _slot();
+            try {
+                N* x = ::new (p) N(std::forward<Types>(args)...);
+                ++_s->_live;
+                return x;
+            }
+            catch (...) {
+                _s->_free_list = ::new (p) void*{_s->_free_list};
+                throw;
+            }
+        }
+
+        /** reserves chunks for n more nodes, so that they are allocated contiguously */
+        void reserve(std::size_t n) {
+            _state_of();
+            std::size_t available = static_cast<std::size_t>(_s->_bump_end - _s->_bump) / sizeof(N);
+            for (auto c = _s->_spare; c; c = c->_next) {
+                available += _per_chunk;
+            }
+            while (available < n) {
+                void* mem = ::operator new(ChunkBytes, std::align_val_t{ChunkBytes});
+                _s->_spare = ::new (mem) _chunk{_s, _s->_spare};
+                available += _per_chunk;
+            }
+        }
+
+        /**
+         * frees all the chunks at once, O(chunks)
+         * the destructors of the nodes are not called: the tree must have forgotten them
+         * and their pairs must be trivially destructible
+         */
+        void release_all() noexcept {
+            delete _s;
+            _s = nullptr;
+        }
+
+        /** function exclusive
+         * @return returns true if the pool has exactly n nodes and no other pool uses its state,
+         * i.e. if a tree of n nodes can free them with release_all */
+        bool exclusive(std::size_t n) const noexcept {return !_s || (_s->_owners == 1 && _s->_live == n);}
+
+        /** function same
+         * @return returns true if the two pools use the same state */
+        bool same(const pool& x) const noexcept {return _s == x._s || !x._s;}
+
+        /** function owns
+         * @return returns true if the node n is in a chunk of this pool (or of a pool sharing its state) */
+        bool owns(const N* n) const noexcept {return _s && _chunk_of(n)->_owner == _s;}
+
+        /** function adopt
+         * moves the chunks of x (and the nodes in them) to this pool, in O(chunks + free nodes of x);
+         * the free part of the last chunk of x is not reused
+         * @return returns false, doing nothing, if the state of x is used by another pool too
+         */
+        bool adopt(pool& x) noexcept {
+            if (same(x)) {
+                return true;
+            }
+            if (x._s->_owners != 1) {
+                return false;
+            }
+            if (!_s) {
+                _s = std::exchange(x._s, nullptr);
+                return true;
+            }
+            _state* from = x._s;
+            for (_chunk** list : {&from->_chunks, &from->_spare}) {
+                if (!*list) {
+                    continue;
+                }
+                _chunk* last = *list;
+                for (_chunk* c = *list; c; c = c->_next) {
+                    c->_owner = _s;
+                    last = c;
+                }
+                _chunk*& in_use = _s->_chunks ? _s->_chunks->_next : _s->_chunks;   // the current chunk stays first
+                _chunk*& to = list == &from->_chunks ? in_use : _s->_spare;
+                last->_next = to;
+                to = std::exchange(*list, nullptr);
+            }
+            if (from->_free_list) {
+                void** last = static_cast<void**>(from->_free_list);
+                while (*last) {
+                    last = static_cast<void**>(*last);
+                }
+                *last = _s->_free_list;
+                _s->_free_list = std::exchange(from->_free_list, nullptr);
+            }
+            _s->_live += std::exchange(from->_live, 0);
+            delete from;
+            x._s = nullptr;
+            return true;
+        }
+
+        /** function share
+         * this pool gives up its state (see _drop) and creates its nodes in the state of x */
+        void share(pool& x) {
+            _state* s = x._state_of();
+            if (s != _s) {
+                _drop();
+                _s = s;
+                ++_s->_owners;
+            }
+        }
+    };
+};
+
+#endif
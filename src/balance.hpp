@@ -0,0 +1,277 @@
+#ifndef _bst_balance
+#define _bst_balance
+#include "node.hpp"
+
+#include <algorithm>  //std::max
+#include <cstddef>    //std::size_t
+#include <utility>
+#include <memory>
+
+/**
+ * ********* Balancing policies *********
+ *
+ * a balancing policy is the fourth template argument of bst (after OP)
+ * it decides which extra data each node carries and how the tree is restructured
+ * after every insertion or removal
+ *
+ * every policy provides
+ * meta     --> struct inherited by _node, holding the per-node data of the policy
+ * retrace  --> true if the path from a modified node to the root has to be visited
+ * update   --> recomputes the data of a node from its children, returns true if it changed
+ * fix      --> restructures the subtree rooted at a node, returns the new root of that subtree
+ */
+
+
+/**
+ * function _child_slot
+ * returns the unique pointer that owns the node n:
+ * head if n is the root, otherwise the left or right pointer of its parent
+ */
+template<typename N>
+typename N::node_ptr& _child_slot(typename N::node_ptr& head, N* n) noexcept {
+    if (!n->_parent) {
+        return head;
+    }
+    return n->_parent->_left.get() == n ? n->_parent->_left : n->_parent->_right;
+}
+
+
+/**
+ * function _rotate_left
+ * the right child y of x takes the place of x and x becomes the left child of y
+ * parent pointers are kept valid, so iterators are not invalidated
+ * @return returns y, the new root of the subtree
+ */
+template<typename P, typename N>
+N* _rotate_left(typename N::node_ptr& head, N* x) noexcept {
+    auto& slot = _child_slot(head, x);
+    auto x_owner = std::move(slot);
+    auto y_owner = std::move(x->_right);
+    N* y = y_owner.get();
+
+    x->_right = std::move(y->_left);       // the left subtree of y moves under x
+    if (x->_right) {
+        x->_right->_parent = x;
+    }
+    y->_parent = x->_parent;
+    x->_parent = y;
+    y->_left = std::move(x_owner);
+    slot = std::move(y_owner);
+
+    P::update(x);                          // x is now below y: update it first
+    P::update(y);
+    return y;
+}
+
+
+/**
+ * function _rotate_right
+ * the left child y of x takes the place of x and x becomes the right child of y
+ * @return returns y, the new root of the subtree
+ */
+template<typename P, typename N>
+N* _rotate_right(typename N::node_ptr& head, N* x) noexcept {
+    auto& slot = _child_slot(head, x);
+    auto x_owner = std::move(slot);
+    auto y_owner = std::move(x->_left);
+    N* y = y_owner.get();
+
+    x->_left = std::move(y->_right);       // the right subtree of y moves under x
+    if (x->_left) {
+        x->_left->_parent = x;
+    }
+    y->_parent = x->_parent;
+    x->_parent = y;
+    y->_right = std::move(x_owner);
+    slot = std::move(y_owner);
+
+    P::update(x);
+    P::update(y);
+    return y;
+}
+
+
+/**
+ * function _retrace
+ * walks from n up to the root, updating and fixing every node on the way
+ * it stops as soon as a node is neither changed nor restructured,
+ * since in that case nothing above it can change either
+ */
+template<typename P, typename N>
+void _retrace(typename N::node_ptr& head, N* n) noexcept {
+    if constexpr (P::retrace) {
+        while (n) {
+            bool changed = P::update(n);
+            N* top = P::template fix<P>(head, n);
+            if (!changed && top == n) {
+                return;
+            }
+            n = top->_parent;
+        }
+    }
+    else {
+        (void)head;
+        (void)n;
+    }
+}
+
+
+/**
+ * ********* no_balance *********
+ *
+ * plain binary search tree: nodes are never moved after insertion
+ * sorted input degrades the tree to a list (kept for comparison)
+ */
+struct no_balance {
+
+    /** no data per node */
+    struct meta {};
+
+    /** nothing to visit after a modification */
+    static constexpr bool retrace = false;
+
+    template<typename N>
+    static bool update(N*) noexcept {return false;}
+
+    template<typename P, typename N>
+    static N* fix(typename N::node_ptr&, N* n) noexcept {return n;}
+};
+
+
+/**
+ * ********* avl_balance *********
+ *
+ * AVL tree: the heights of the two subtrees of every node differ by at most one,
+ * so the height of the tree is at most 1.44 log2(n)
+ */
+struct avl_balance {
+
+    /** height of the subtree rooted at the node (a leaf has height 1) */
+    struct meta {
+        int _height{1};
+    };
+
+    static constexpr bool retrace = true;
+
+    /** height of a subtree, 0 for an empty one */
+    template<typename N>
+    static int height(const N* n) noexcept {return n ? n->_height : 0;}
+
+    /** recomputes the height of n from its children */
+    template<typename N>
+    static bool update(N* n) noexcept {
+        int h = 1 + std::max(height(n->_left.get()), height(n->_right.get()));
+        bool changed = h != n->_height;
+        n->_height = h;
+        return changed;
+    }
+
+    /**
+     * restores the AVL property at n with a single or a double rotation
+     * @return returns the new root of the subtree
+     */
+    template<typename P, typename N>
+    static N* fix(typename N::node_ptr& head, N* n) noexcept {
+        int diff = height(n->_left.get()) - height(n->_right.get());
+
+        if (diff > 1) {                                 // left heavy
+            N* l = n->_left.get();
+            if (height(l->_left.get()) < height(l->_right.get())) {
+                _rotate_left<P>(head, l);               // left-right case
+            }
+            return _rotate_right<P>(head, n);
+        }
+        if (diff < -1) {                                // right heavy
+            N* r = n->_right.get();
+            if (height(r->_right.get()) < height(r->_left.get())) {
+                _rotate_right<P>(head, r);              // right-left case
+            }
+            return _rotate_left<P>(head, n);
+        }
+        return n;
+    }
+};
+
+
+/**
+ * function _subtree_count
+ * @return returns the number of nodes of the subtree rooted at n (order_statistics), 0 for nullptr
+ */
+template<typename N>
+std::size_t _subtree_count(const N* n) noexcept {return n ? n->_count : 0;}
+
+/**
+ * function _node_index
+ * climbs from n to the root, adding the nodes on the left of the path
+ * @return returns the position of n in its tree, in order (from 0)
+ */
+template<typename N>
+std::size_t _node_index(const N* n) noexcept {
+    std::size_t i = _subtree_count(n->_left.get());
+    for (; n->_parent; n = n->_parent) {
+        if (n->_parent->_right.get() == n) {
+            i += _subtree_count(n->_parent->_left.get()) + 1;
+        }
+    }
+    return i;
+}
+
+/**
+ * function _node_select
+ * descends from root choosing the side by the count of the left subtree
+ * @return returns the node at position k of the subtree rooted at root, nullptr if k >= its count
+ */
+template<typename N>
+N* _node_select(N* root, std::size_t k) noexcept {
+    while (root) {
+        std::size_t left = _subtree_count(root->_left.get());
+        if (k < left) {
+            root = root->_left.get();
+        }
+        else if (k == left) {
+            return root;
+        }
+        else {
+            k -= left + 1;
+            root = root->_right.get();
+        }
+    }
+    return nullptr;
+}
+
+
+/**
+ * ********* order_statistics *********
+ *
+ * augmentation of another policy P (no_balance by default, or avl_balance): every node also stores
+ * the number of nodes of its subtree, so that the tree finds the k-th key, the rank of a key and
+ * the distance between two iterators in O(height) (see nth, rank and count_range of bst)
+ * the counts change on the whole path to the root after every insertion and removal,
+ * so the path is always retraced (update returns true as long as a count changes)
+ */
+template<typename P = no_balance>
+struct order_statistics {
+
+    /** the data of P and the number of nodes of the subtree rooted at the node */
+    struct meta : P::meta {
+        std::size_t _count{1};
+    };
+
+    static constexpr bool retrace = true;
+
+    /** recomputes the data of P and the count of n from its children */
+    template<typename N>
+    static bool update(N* n) noexcept {
+        bool changed = P::update(n);
+        std::size_t count = 1 + _subtree_count(n->_left.get()) + _subtree_count(n->_right.get());
+        changed = changed || count != n->_count;
+        n->_count = count;
+        return changed;
+    }
+
+    /** restructures the subtree as P does (the rotations update the counts through Q) */
+    template<typename Q, typename N>
+    static N* fix(typename N::node_ptr& head, N* n) noexcept {return P::template fix<Q>(head, n);}
+};
+
+#endif
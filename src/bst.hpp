@@ -2,12 +2,31 @@
 #define _bst
 #include "node.hpp"
 #include "iterator.hpp"
+#include "balance.hpp"
+#include "allocator.hpp"
+#include "traits.hpp"
+#include "frozen.hpp"
+#include "parallel.hpp"
+#include "stream.hpp"
+#include "stats.hpp"
+#include "node_handle.hpp"
 
 #include <iostream>
 #include <iterator>
 #include <utility>
 #include <memory>
 #include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <string>
+#include <cmath>         //std::log2
+
+/**
+ * tag type for the bulk construction of a bst:
+ * the caller guarantees that the range is sorted by key (with respect to OP) and has no duplicate keys
+ */
+struct sorted_unique_t { explicit sorted_unique_t() = default; };
+inline constexpr sorted_unique_t sorted_unique{};
 
 /**
  * ********* Class bst **********
@@ -18,47 +37,376 @@
  * @param k_t --> template for key type
  * @param v_t --> template for value type
  * @param OP  --> template for Operator Comparison (OP) which is std::less<k_t>
+ * @param BP  --> template for the balancing policy: no_balance (default) or avl_balance, optionally
+ *                augmented with order_statistics (see balance.hpp)
+ * @param AP  --> template for the allocator policy: heap_alloc (default) or arena_alloc (see allocator.hpp)
  */ 
 
-template <typename k_t, typename v_t, typename OP = std::less<k_t> >
+template <typename k_t, typename v_t, typename OP = std::less<k_t>, typename BP = no_balance, typename AP = heap_alloc>
 class bst{
 
  private:   
     // overloading of classes node and iterator 
-    using node =  _node< k_t, v_t>;
-    using iterator = _iterator<k_t,k_t,v_t>;
-    using const_iterator = _iterator<const k_t,k_t,v_t>;  //const key type for iterator
+    using node =  _node< k_t, v_t, typename BP::meta, AP>;
+    using node_ptr = typename node::node_ptr;
+    using iterator = _iterator<k_t,node>;
+    using const_iterator = _iterator<const k_t,node>;  //const key type for iterator
 
     /** private members of the class*/
-    std::unique_ptr<node> head;
-    OP comp;                         //comparision 
+    typename AP::template pool<node> _pool;    //creates the nodes - declared before head, which is destroyed first
+    node_ptr head;
+    _counting_compare<OP> comp;      //comparision (with the counters of BST_STATS, see stats.hpp)
+    std::size_t _size{0};            //number of nodes
+    node* _leftmost{nullptr};        //node with the smallest key (nullptr if empty)
+    node* _rightmost{nullptr};       //node with the largest key (nullptr if empty)
+
+    /** state of auto_balance */
+    struct _auto_state {
+        double threshold{0};         // 0: off
+        std::size_t work{0};         // depth of the deep insertions since the last check
+        std::uint64_t balances{0};   // calls of balance() made so far
+    } _auto;
+
+    /** auxiliary function _refresh_bounds
+     * recomputes _leftmost and _rightmost walking down the two sides of the tree
+     * used after the operations that rebuild the whole tree */
+    void _refresh_bounds() noexcept {
+        _leftmost = _rightmost = head.get();
+        while (_leftmost && _leftmost->_left) {
+            _leftmost = _leftmost->_left.get();
+        }
+        while (_rightmost && _rightmost->_right) {
+            _rightmost = _rightmost->_right.get();
+        }
+    }
+
+    /** auxiliary function _make_node
+     * creates a node in the pool of the tree
+     * @return returns the unique pointer owning the new node */
+    template<typename... Types>
+    node_ptr _make_node(Types&&... args) {return node_ptr{_pool.make(std::forward<Types>(args)...)};}
+
+    /** private function _copy
+     * deep copy of the subtree rooted at x, with nodes created in the pool of this tree
+     * iterative: the two trees are walked together through the parent pointers, O(1) stack
+     * @param x --> root of the subtree to copy (not nullptr)
+     * @return returns the unique pointer owning the copy
+     */
+    node_ptr _copy(const node* x);  //declaration
+
+    /** private function _destroy
+     * destroys the subtree owned by root, deleting the leaves one by one and going back up
+     * through the parent pointers: O(1) stack, even on a degenerate tree
+     */
+    static void _destroy(node_ptr& root) noexcept;  //declaration
    
     /** auxiliary function */
     bool _is_empty() const noexcept {return head == nullptr;}
 
     /**
      * function left_most
-     * returns an iterator to the node with smallest key value
+     * returns an iterator to the node with smallest key value (kept up to date, O(1))
      */ 
-    iterator left_most() noexcept {
-        auto tmp = head.get();  //raw pointer
-        while (tmp->_left) {
-            tmp = tmp->_left.get();
-        }
-        return iterator{tmp};
-    }
+    iterator left_most() noexcept {return iterator{_leftmost, &_rightmost};}
 
     /**
      * function left_most - const
      * returns a const_iterator to the node with smallest key value
      */ 
-    const_iterator left_most() const noexcept {
-        auto tmp = head.get();  //raw pointer
-        while (tmp->_left) {
-            tmp = tmp->_left.get();
+    const_iterator left_most() const noexcept {return const_iterator{_leftmost, &_rightmost};}
+
+    /** result of _locate: where a key is, or where it would be attached */
+    struct _position {
+        node* found;      // node with the key, nullptr if the key is missing
+        node* parent;     // last node visited, parent of the new node if the key is missing
+        bool left;        // the new node would be the left child of parent
+        std::size_t depth{0};   // depth of the new node if counted by the descent, 0 otherwise
+    };
+
+    /** private function _locate
+     * descends once from the root comparing x with the key of every visited node
+     * (at most two comparisons per level)
+     * @return returns the position of the key x
+     */
+    template<typename K>
+    _position _locate(const K& x) const noexcept {
+        _position pos{nullptr, nullptr, false};
+        auto tmp{head.get()};
+        while (tmp) {
+            pos.parent = tmp;
+            ++pos.depth;
+            if (comp(x, tmp->_pair.first)) {          // key(x) < key(tmp) --> go left
+                pos.left = true;
+                tmp = tmp->_left.get();
+            }
+            else if (comp(tmp->_pair.first, x)) {     // key(tmp) < key(x) --> go right
+                pos.left = false;
+                tmp = tmp->_right.get();
+            }
+            else {                                    // key(x) == key(tmp)
+                pos.found = tmp;
+                return pos;
+            }
+        }
+        return pos;
+    }
+
+    /** private function _attach
+     * links the new node n at the position returned by _locate (key missing) and rebalances the tree
+     * @return returns a raw pointer to the new node
+     */
+    node* _attach(const _position& pos, node_ptr n) noexcept {
+        node* x = n.get();
+        x->_parent = pos.parent;
+        if (!pos.parent) {
+            head = std::move(n);
+        }
+        else if (pos.left) {
+            pos.parent->_left = std::move(n);
+        }
+        else {
+            pos.parent->_right = std::move(n);
+        }
+        if (!pos.parent || (pos.parent == _leftmost && pos.left)) {
+            _leftmost = x;
+        }
+        if (!pos.parent || (pos.parent == _rightmost && !pos.left)) {
+            _rightmost = x;
+        }
+        _rebalance(pos.parent);   // the new node is a leaf: start from its parent
+        ++_size;
+        if (_auto.threshold > 0) {
+            _check_depth(x, pos.depth);
+        }
+        return x;
+    }
+
+    /** private function _depths
+     * calls f(depth) for every node, the root at depth 0, walking the tree in pre-order
+     * through the parent pointers (O(n) time, O(1) stack) */
+    template<typename F>
+    void _depths(F&& f) const noexcept;  //declaration
+
+    /** private function _average_depth
+     * @return returns the mean depth of the nodes (0 if empty), in O(n) */
+    double _average_depth() const noexcept {
+        double sum = 0;
+        _depths([&sum](std::size_t d) {sum += static_cast<double>(d);});
+        return _size ? sum / static_cast<double>(_size) : 0.0;
+    }
+
+    /** private function _check_depth
+     * called by _attach for the new node x when auto_balance is on (depth: its depth, 0 if unknown, e.g.
+     * after a hint, so that it is counted through the parent pointers): if x is deeper than
+     * threshold * log2(n + 1), its depth is added to the work of the deep insertions; when that work
+     * reaches n the average depth is computed (O(n), paid by the descents that have reached deep nodes)
+     * and the tree is balanced if it exceeds threshold * log2(n + 1)
+     */
+    void _check_depth(const node* x, std::size_t depth) noexcept {
+        if (depth == 0) {
+            for (const node* p = x->_parent; p; p = p->_parent) {
+                ++depth;
+            }
+        }
+        double limit = _auto.threshold * std::log2(static_cast<double>(_size) + 1);
+        if (static_cast<double>(depth) <= limit) {
+            return;
+        }
+        _auto.work += depth;
+        if (_auto.work < _size) {
+            return;
+        }
+        _auto.work = 0;
+        if (_average_depth() > limit) {
+            balance();
+            ++_auto.balances;
+        }
+    }
+
+    /**
+     * function _locate_hint
+     * like _locate, but first checks whether x belongs right next to hint:
+     * just before it (hint == end() means after the last node) or just after it.
+     * If so it costs one or two comparisons and no descent, otherwise it falls back to _locate
+     * @param hint --> node next to which x is expected (nullptr for end())
+     */
+    _position _locate_hint(node* hint, const k_t& x) const noexcept;  //declaration
+
+    /** private function _find
+     * descends once, with at most two comparisons per level
+     * @return returns the node with key x, nullptr if there is none */
+    template<typename K>
+    node* _find(const K& x) const noexcept {
+        auto scope = comp.scope(_counted_op::find);
+        auto tmp{head.get()};
+        while (tmp) {                              // traverse the bst until tmp is nullptr  
+            if (comp(x, tmp->_pair.first)) {       // key(x) < key(tmp) --> traverse the left side of tree
+                tmp = tmp->_left.get();
+            }
+            else if (comp(tmp->_pair.first, x)) {  // key(tmp) < key(x) --> traverse the right side of tree
+                tmp = tmp->_right.get();
+            }
+            else {                                 //  key(x) == key(tmp) 
+                return tmp;
+            }
+        }
+        return nullptr;
+    }
+
+    /** private function _erase
+     * removes the node with key x, if any
+     * @return returns true if a node has been removed */
+    template<typename K>
+    bool _erase(const K& x) noexcept {
+        auto scope = comp.scope(_counted_op::erase);
+        node* n = _find(x);
+        if (n) {
+            _unlink(n);          // the returned owner deletes the node
+        }
+        return n != nullptr;
+    }
+
+    /** private function _lower
+     * descends once, remembering the last node whose key is not less than x
+     * @return returns the first node with key >= x, nullptr if there is none */
+    template<typename K>
+    node* _lower(const K& x) const noexcept {
+        auto scope = comp.scope(_counted_op::find);
+        node* result = nullptr;
+        auto tmp{head.get()};
+        while (tmp) {
+            if (!comp(tmp->_pair.first, x)) {    // key(tmp) >= x: candidate, look for a smaller one
+                result = tmp;
+                tmp = tmp->_left.get();
+            }
+            else {
+                tmp = tmp->_right.get();
+            }
+        }
+        return result;
+    }
+
+    /** private function _upper
+     * @return returns the first node with key > x, nullptr if there is none */
+    template<typename K>
+    node* _upper(const K& x) const noexcept {
+        auto scope = comp.scope(_counted_op::find);
+        node* result = nullptr;
+        auto tmp{head.get()};
+        while (tmp) {
+            if (comp(x, tmp->_pair.first)) {     // key(tmp) > x: candidate, look for a smaller one
+                result = tmp;
+                tmp = tmp->_left.get();
+            }
+            else {
+                tmp = tmp->_right.get();
+            }
+        }
+        return result;
+    }
+
+    /** private function _equal_range
+     * @return returns the pair of iterators (of type I) lower_bound(x), upper_bound(x) */
+    template<typename I, typename K>
+    std::pair<I, I> _equal_range(const K& x) const noexcept {
+        I first{_lower(x), &_rightmost};
+        I last{first};
+        if (first.current_ptr() && !comp(x, *first)) {    // key(first) == x
+            ++last;
+        }
+        return std::pair<I, I>{first, last};
+    }
+
+    /** private function _nth
+     * @return returns the node with the k-th smallest key, nullptr if k >= _size */
+    node* _nth(std::size_t k) const noexcept {
+        static_assert(_stores_count<node>::value, "nth needs the order_statistics policy");
+        return _node_select(head.get(), k);
+    }
+
+    /** private function _rank
+     * descends as _lower, adding the nodes left behind when going right
+     * @return returns the number of keys less than x */
+    template<typename K>
+    std::size_t _rank(const K& x) const noexcept {
+        static_assert(_stores_count<node>::value, "rank and count_range need the order_statistics policy");
+        auto scope = comp.scope(_counted_op::find);
+        std::size_t r = 0;
+        auto tmp{head.get()};
+        while (tmp) {
+            if (comp(tmp->_pair.first, x)) {     // key(tmp) < x: tmp and its left subtree are less than x
+                r += _subtree_count(tmp->_left.get()) + 1;
+                tmp = tmp->_right.get();
+            }
+            else {
+                tmp = tmp->_left.get();
+            }
+        }
+        return r;
+    }
+
+    /** number of lookups advanced together by _find_batch */
+    static constexpr std::size_t _batch_group = 16;
+
+    /** private function _find_batch
+     * looks up the keys in [first, last) in groups of _batch_group, advancing all the lookups of a group
+     * by one level at a time and prefetching the next node of each, so that their cache misses overlap
+     * @param emit called, in the order of the keys, with the node of each key (nullptr if not present) */
+    template<typename InIt, typename F>
+    void _find_batch(InIt first, InIt last, F&& emit) const {
+        static_assert(std::is_lvalue_reference_v<typename std::iterator_traits<InIt>::reference>,
+                      "find_batch needs a range of keys stored in memory");
+        const k_t* keys[_batch_group];
+        node* current[_batch_group];
+        node* found[_batch_group];
+        while (first != last) {
+            std::size_t group = 0;
+            for (; group < _batch_group && first != last; ++group, ++first) {
+                keys[group] = &*first;
+                current[group] = head.get();
+                found[group] = nullptr;
+            }
+            auto scope = comp.scope(_counted_op::find, group);
+            bool active = head != nullptr;
+            while (active) {                           // one level of every lookup of the group
+                active = false;
+                for (std::size_t i = 0; i < group; ++i) {
+                    node* tmp = current[i];
+                    if (!tmp) {
+                        continue;
+                    }
+                    if (comp(*keys[i], tmp->_pair.first)) {
+                        tmp = tmp->_left.get();
+                    }
+                    else if (comp(tmp->_pair.first, *keys[i])) {
+                        tmp = tmp->_right.get();
+                    }
+                    else {
+                        found[i] = tmp;
+                        tmp = nullptr;
+                    }
+                    if (tmp) {
+#if defined(__GNUC__)
+                        __builtin_prefetch(tmp);       // read at the next round, after the other lookups
+#endif
+                        active = true;
+                    }
+                    current[i] = tmp;
+                }
+            }
+            for (std::size_t i = 0; i < group; ++i) {
+                emit(found[i]);
+            }
         }
-        return const_iterator{tmp};
     }
+
+    /** private function _range_end
+     * @return returns an iterator (of type I) to lower_bound(hi), or to lower_bound(lo) if hi < lo (empty range) */
+    template<typename I>
+    I _range_end(const k_t& lo, const k_t& hi) const noexcept {
+        return I{comp(hi, lo) ? _lower(lo) : _lower(hi), &_rightmost};
+    }
+
     /** private function _insert 
      * is used to insert a new node in the tree
      * the bool is true if a new node has been allocated, false otherwise (i.e. the key already exists)
@@ -67,14 +415,201 @@ class bst{
     template<typename O>
     std::pair<iterator, bool> _insert(O&& x);    //declaration 
 
-    /** @brief private function make_balance
-     * is used to balance the tree
-     * @param v --> vector of pairs
-     * @param start --> first index
-     * @param end --> last index
+    /** private function _insert_hint
+     * same as _insert, with the position searched next to hint first
+     * @return returns an iterator to the node with the key of x
+     */
+    template<typename O>
+    iterator _insert_hint(node* hint, O&& x){
+        auto scope = comp.scope(_counted_op::insert);
+        auto pos = _locate_hint(hint, x.first);
+        if (pos.found) {
+            return iterator{pos.found, &_rightmost};
+        }
+        comp.allocated(1);
+        return iterator{_attach(pos, _make_node(std::forward<O>(x))), &_rightmost};
+    }
+
+    /** @brief private function make_vine
+     * first step of balance: turns the tree into a "vine" (a list of right children, sorted by key)
+     * using right rotations
+     * @return returns the number of nodes
+     */
+    std::size_t make_vine() noexcept;  //declaration
+
+    /** @brief private function compress
+     * second step of balance: applies a left rotation to every other node
+     * along the right spine, for the first count nodes
+     * @param count --> number of rotations
+     */
+    void compress(std::size_t count) noexcept;  //declaration
+
+    /** @brief private function _join
+     * links the trees l and r with the node m between them (every key of l < key of m < every key of r);
+     * with a policy storing the heights (avl_balance) m is attached along the spine of the taller tree
+     * at the height of the other one and the path above it is retraced, in O(|height(l) - height(r)| + 1),
+     * otherwise m becomes the root
+     * @return returns the unique pointer owning the root of the joined tree
+     */
+    static node_ptr _join(node_ptr l, node_ptr m, node_ptr r) noexcept;  //declaration
+
+    /** @brief private function _take_nodes
+     * makes the nodes of x linkable in this tree: nothing to do if the pools are the same, otherwise
+     * the pool of x is adopted, or, if it is shared with a third tree, x is replaced by a copy made in this pool
+     */
+    void _take_nodes(bst& x);  //declaration
+
+    /** @brief private function _combine
+     * walks this tree and x together in order and builds a balanced tree with the pairs of the keys
+     * only in this tree (if only_this), only in x (if only_x) and in both (if both, the pair of this tree)
+     * @return returns the new tree
+     */
+    bst _combine(const bst& x, bool only_this, bool only_x, bool both) const;  //declaration
+
+    /** @brief private function _update_all
+     * recomputes the data of the balancing policy in every node, children before parents
+     * (post-order walk through the parent pointers, no recursion)
+     */
+    void _update_all() noexcept;  //declaration
+
+    /** @brief private function _build
+     * builds a balanced subtree with the next n pairs of a sorted range, in order:
+     * left subtree, then the node itself, then right subtree
+     * @param n --> number of nodes of the subtree
+     * @param first --> iterator to the next pair, advanced by n
+     * @return returns the unique pointer owning the root of the subtree
+     */
+    template <typename It>
+    node_ptr _build(std::size_t n, It& first);  //declaration
+
+    /** @brief private function _build_from
+     * as _build, with the pairs taken by position instead of in order
+     * @param lo --> position of the first pair of the subtree
+     * @param n --> number of nodes of the subtree
+     * @param make --> make(i) returns the node of the pair at position i, without children
+     * @return returns the unique pointer owning the root of the subtree
+     */
+    template <typename Make>
+    node_ptr _build_from(std::size_t lo, std::size_t n, Make& make);  //declaration
+
+    /** @brief private function _build_parallel
+     * builds a balanced tree with n pairs like _build_from: the nodes of the top levels are made
+     * by the calling thread, the subtrees below them by `threads` threads
+     * it allocates before the first call of make, so nothing throws once make has been called
+     * (if make and the pool do not throw)
+     * @return returns the unique pointer owning the root
+     */
+    template <typename Make>
+    node_ptr _build_parallel(std::size_t n, Make& make, std::size_t threads);  //declaration
+
+    /** private function _copy_parallel
+     * deep copy of the subtree rooted at x like _copy: the nodes of the top levels are copied
+     * by the calling thread, the subtrees below them by `threads` threads (the pool must support
+     * concurrent_make)
+     * @return returns the unique pointer owning the copy
+     */
+    node_ptr _copy_parallel(const node* x, std::size_t threads);  //declaration
+
+    /** minimum number of nodes for which the parallel operations start threads */
+    static constexpr std::size_t _parallel_cutoff = std::size_t{1} << 14;
+
+    /** part of the tree returned by _split: a node of the top levels, or a whole subtree below them */
+    struct _piece {
+        node* root;
+        bool subtree;
+    };
+
+    /** private function _split
+     * cuts the top `levels` levels of the subtree rooted at x
+     * @param out --> receives, in order, the nodes of the top levels and the roots of the subtrees below them
+     */
+    static void _split(node* x, std::size_t levels, std::vector<_piece>& out) {
+        if (!x) {
+            return;
+        }
+        if (levels == 0) {
+            out.push_back(_piece{x, true});
+            return;
+        }
+        _split(x->_left.get(), levels - 1, out);
+        out.push_back(_piece{x, false});
+        _split(x->_right.get(), levels - 1, out);
+    }
+
+    /** private function _visit
+     * calls visit(n) for every node n of the subtree rooted at x, in order
+     * (from the leftmost node of the subtree to the first ancestor having the subtree on its left)
+     */
+    template <typename F>
+    void _visit(node* x, F& visit) const {
+        node* stop = x;
+        while (stop->_parent && stop->_parent->_right.get() == stop) {
+            stop = stop->_parent;
+        }
+        stop = stop->_parent;
+        while (x->_left) {
+            x = x->_left.get();
+        }
+        for (iterator it{x, &_rightmost}; it.current_ptr() != stop; ++it) {
+            visit(it.current_ptr());
+        }
+    }
+
+    /** private function _for_each_parallel
+     * calls visit(n) for every node n, the pieces returned by _split being visited by `threads` threads
+     */
+    template <typename F>
+    void _for_each_parallel(F& visit, std::size_t threads) const {
+        if (!head) {
+            return;
+        }
+        if (threads < 2 || _size < _parallel_cutoff) {
+            _visit(head.get(), visit);
+            return;
+        }
+        std::vector<_piece> pieces;
+        _split(head.get(), _split_levels(threads), pieces);
+        _parallel_for(threads, pieces.size(), [&](std::size_t i) {
+            if (pieces[i].subtree) {
+                _visit(pieces[i].root, visit);
+            }
+            else {
+                visit(pieces[i].root);
+            }
+        });
+    }
+
+    /** reads the pairs of a frozen_bst in order, as _build reads a range (operator* and operator++) */
+    struct _frozen_pairs {
+        typename frozen_bst<k_t, v_t, OP>::const_iterator it;
+        std::pair<k_t, v_t> operator*() const {return std::pair<k_t, v_t>{*it, it.value()};}
+        _frozen_pairs& operator++() noexcept {
+            ++it;
+            return *this;
+        }
+    };
+
+    /** @brief private function _is_sorted_unique
+     * @return returns true if the keys of the range are strictly increasing with respect to comp
+     */
+    template <typename It>
+    bool _is_sorted_unique(It first, It last) const;  //declaration
+
+    /** 
+     * private function _rebalance
+     * restores the balancing policy on the path from n to the root
+     * it must be called after every change of the links below n
+     */
+    void _rebalance(node* n) noexcept {_retrace<BP>(head, n);}
+
+    /**
+     * private function _unlink
+     * detaches the node n from the tree and rebalances it
+     * if n has two children, its successor is moved (relinked) in its place,
+     * so no pair is copied and iterators to the other nodes stay valid
+     * @return returns the unique pointer owning n
      */
-    template <typename P>
-    void make_balance(std::vector<P> v, int start, int end) ;  //declaration
+    node_ptr _unlink(node* n) noexcept;     //declaration
                         
  public:
 
@@ -94,40 +629,284 @@ class bst{
       */
     std::pair<iterator, bool> insert(std::pair<k_t, v_t>&& x) {return _insert(std::move(x));}
 
-    /** function to balance the tree - uses the private function make_balance 
-     * it traverse the bst inorder and stores all the pairs in a vector v;
-     * then clears the tree and insert the nodes
-     * starting from the median of v and again recursively on the left and right subvectors of v
+    /** function insert - with hint, l-value reference to the pair
+     * like insert, but if the key of x belongs right next to hint (just before it, or just after it)
+     * the node is attached there with one or two comparisons instead of a descent from the root;
+     * for increasing keys pass end() or the iterator returned by the previous insertion
+     * @return returns an iterator to the node with the key of x (new or already present)
+     */
+    iterator insert(iterator hint, const std::pair<k_t, v_t>& x) {return _insert_hint(hint.current_ptr(), x);}
+
+    /** function insert - with hint, r-value reference to the pair
+     * @return returns an iterator to the node with the key of x (new or already present)
+     */
+    iterator insert(iterator hint, std::pair<k_t, v_t>&& x) {return _insert_hint(hint.current_ptr(), std::move(x));}
+
+    /** type of the node handles returned by extract (see node_handle.hpp) */
+    using node_type = _node_handle<node>;
+
+    /** function extract
+     * unlinks the node with key x, as erase does, but hands it to the caller instead of freeing it
+     * (no message if the key is missing)
+     * @return returns the handle owning the node, empty if there is no node with key x */
+    node_type extract(const k_t& x) noexcept {
+        auto scope = comp.scope(_counted_op::erase);
+        node* n = _find(x);
+        return n ? node_type{_unlink(n)} : node_type{};
+    }
+
+    /** function extract - iterator
+     * @return returns the handle owning the node pointed by pos, which must be a node of this tree (or end(): empty) */
+    node_type extract(iterator pos) noexcept {
+        node* n = pos.current_ptr();
+        return n ? node_type{_unlink(n)} : node_type{};
+    }
+
+    /** function insert - node handle
+     * links the node of nh with one descent, as insert does with a pair: nothing is allocated and the pair
+     * is not moved. With arena_alloc a node extracted from a tree with another pool cannot be linked
+     * (the nodes of a tree live in its pool): its pair is moved into a new node of this pool.
+     * If the key is already present nh keeps its node
+     * @return returns a pair of an iterator (to the node with the key of nh) and a bool, true if nh has been inserted */
+    std::pair<iterator, bool> insert(node_type&& nh);  //declaration
+
+    /** function to balance the tree in place - uses the private functions make_vine and compress
+     * (Day-Stout-Warren algorithm): the existing nodes are relinked into a tree of minimal height
+     * in O(n) time, with no allocation, no comparison and no copy of the pairs
     */
-    void balance();
+    void balance() noexcept;
+
+    /** function balance - parallel
+     * balances the tree with `threads` threads: the nodes are collected in order, one task per
+     * subtree below the top levels, then relinked into a tree of minimal height, one task per subtree
+     * as balance, no pair is copied and no node is allocated; small trees are balanced sequentially
+     * @param threads --> number of threads, the calling one included
+     */
+    void balance(std::size_t threads);
+
+    /** function merge
+     * moves every node of x into this tree, relinking them: no node is allocated or copied, and x is left empty
+     * (with arena_alloc the pool of x is adopted; only if it is shared with a third tree, see split, the pairs
+     * of x are copied). For a key in both trees the pair of this tree is kept and the node of x is destroyed.
+     * A small x (m log n < n + m) is attached node by node with one descent each, otherwise the two trees
+     * are walked together in order, with at most n + m comparisons, and all the nodes are relinked in
+     * balanced shape as by balance(threads): O(n + m)
+     */
+    void merge(bst&& x);  //declaration
+
+    /** function split
+     * moves the nodes with key not less than x to a new tree; this tree keeps the smaller ones.
+     * The search path of x is cut and its pieces are joined again (see _join), so no node is allocated:
+     * O(log n) with avl_balance, O(height) otherwise. The sizes of the two trees are the counts of their
+     * roots with order_statistics, otherwise the smaller tree is counted, O(min(n1, n2)).
+     * With arena_alloc the two trees share the pool
+     * @return returns the tree with the keys not less than x
+     */
+    bst split(const k_t& x);  //declaration
+
+    /** function join
+     * moves the nodes of x into this tree when the keys of x are all greater (or all smaller) than the keys
+     * of this tree, checked in O(1) (otherwise it does merge): the two trees are linked through the first
+     * (last) node of x, O(log n + log m) with avl_balance and O(1) otherwise; x is left empty
+     */
+    void join(bst&& x);  //declaration
+
+    /** function set_union
+     * the two trees are walked together in order, with at most n + m comparisons, and the result is built
+     * directly in balanced shape (as assign with sorted_unique): O(n + m); for a key in both trees the pair of a is kept
+     * @return returns a new tree with the pairs of the keys in a or in b */
+    friend bst set_union(const bst& a, const bst& b) {return a._combine(b, true, true, true);}
+
+    /** function set_intersection
+     * O(n + m), as set_union
+     * @return returns a new tree with the pairs of a whose keys are also in b */
+    friend bst set_intersection(const bst& a, const bst& b) {return a._combine(b, false, false, true);}
+
+    /** function set_difference
+     * O(n + m), as set_union
+     * @return returns a new tree with the pairs of a whose keys are not in b */
+    friend bst set_difference(const bst& a, const bst& b) {return a._combine(b, true, false, false);}
+
+    /** function size
+     * @return returns the number of nodes, O(1) */
+    std::size_t size() const noexcept {return _size;}
+
+    /** function empty
+     * @return returns true if the tree has no node */
+    bool empty() const noexcept {return _is_empty();}
+
+    /** function height
+     * O(1) if the balancing policy stores the height of the subtrees (avl_balance), O(n) otherwise
+     * @return returns the number of levels (0 if empty, 1 for the root alone) */
+    std::size_t height() const noexcept;  //declaration
+
+    /** function depth_histogram
+     * @return returns the number of nodes at each depth (the root at depth 0), in O(n) */
+    std::vector<std::size_t> depth_histogram() const;  //declaration
+
+    /** function stats
+     * snapshot of the shape of the tree (O(n), see depth_histogram) and of its counters
+     * (comparisons per operation and allocations, only with BST_STATS, see stats.hpp)
+     * @return returns the snapshot */
+    bst_stats stats() const;  //declaration
+
+    /** function reset_stats
+     * sets the counters of BST_STATS back to 0 */
+    void reset_stats() noexcept {
+        comp.reset();
+        _auto.balances = 0;
+    }
+
+    /** function auto_balance
+     * balances the tree when its average depth exceeds threshold * log2(n + 1) (a balanced tree has
+     * average depth about log2(n + 1) - 2, a random one about 1.39 log2(n)): the average is computed
+     * only after insertions deeper than that limit, once their descents have cost n steps, so the
+     * check is O(1) amortized per insertion
+     * @param threshold --> e.g. 3; 0 (the default) turns it off
+     */
+    void auto_balance(double threshold) noexcept {
+        _auto.threshold = threshold;
+        _auto.work = 0;
+    }
+
+    /** function freeze
+     * copies the tree into a read-only snapshot: keys in one contiguous array in Eytzinger order,
+     * searched without branches (see frozen.hpp); later changes of the tree do not affect it
+     * @return returns the snapshot */
+    frozen_bst<k_t, v_t, OP> freeze() const {return frozen_bst<k_t, v_t, OP>{*this, _size, comp.op};}
     
+    /** function save
+     * writes the tree to a binary file (see serialize.hpp): with flat serializers (trivially copyable
+     * keys and values) the file holds the arrays of freeze(), which frozen_bst::load maps in place;
+     * otherwise the pairs are written in order by serializer<k_t> and serializer<v_t>
+     * throws std::runtime_error if the file cannot be written */
+    void save(const std::string& path) const;  //declaration
+
+    /** function load
+     * replaces the content of the tree with the pairs of a file written by save:
+     * the file is mapped and the tree is built directly in balanced shape in O(n), as assign with sorted_unique
+     * throws std::runtime_error if the file cannot be read, is truncated or was saved with other types */
+    void load(const std::string& path);  //declaration
+
+    /** function export_records
+     * writes the pairs in order to sink as records of the given format (see stream.hpp):
+     * they are formatted in a fixed buffer, with no allocation, and handed to the sink in chunks
+     * @param sink --> callable with (const char* data, std::size_t n), e.g. ostream_sink or file_sink
+     */
+    template<typename Sink>
+    void export_records(Sink&& sink, record_format format = record_format::text) const;  //declaration
+
+    /** function import_records
+     * replaces the content of the tree with the records read from source, in the given format,
+     * through assign: records sorted by key (as written by export_records) are built directly in balanced shape
+     * throws std::runtime_error for a malformed or truncated record
+     * @param source --> callable with (char* buffer, std::size_t n) returning the bytes read, 0 at the end
+     */
+    template<typename Source>
+    void import_records(Source&& source, record_format format = record_format::text);  //declaration
+
     /**  default ctor */
     bst() noexcept = default;
 
-    /** default dtor */
-    ~bst() noexcept = default;
+    /** range ctor
+     * builds a balanced tree with the pairs in [first, last), see function assign
+     */
+    template <typename It>
+    bst(It first, It last) {assign(first, last);}
+
+    /** range ctor - sorted
+     * builds a balanced tree with the pairs in [first, last), which must be sorted and unique
+     */
+    template <typename It>
+    bst(sorted_unique_t, It first, It last) {assign(sorted_unique, first, last);}
+
+    /** function assign - sorted
+     * replaces the content of the tree with the pairs in [first, last), which must be sorted
+     * by key and without duplicates (not checked). The tree is built directly in balanced shape
+     * in O(n), with no comparison; pairs are moved if the range is made of move iterators
+     */
+    template <typename It>
+    void assign(sorted_unique_t, It first, It last){
+        clear();
+        auto n = static_cast<std::size_t>(std::distance(first, last));
+        _pool.reserve(n);
+        head = _build(n, first);
+        _size = n;
+        comp.allocated(n);
+        _refresh_bounds();
+    }
+
+    /** function assign - sorted, parallel
+     * as assign with sorted_unique, the subtrees below the top levels being built by `threads` threads
+     * used for random access ranges when the pool can create nodes concurrently (heap_alloc),
+     * otherwise the tree is built sequentially
+     * @param threads --> number of threads, the calling one included
+     */
+    template <typename It>
+    void assign(sorted_unique_t, It first, It last, std::size_t threads);  //declaration
+
+    /** function assign
+     * replaces the content of the tree with the pairs in [first, last)
+     * if the range is already sorted (checked in O(n) for forward ranges) the tree is built directly,
+     * otherwise the pairs are sorted in a buffer first; for duplicate keys the first pair wins, like insert
+     */
+    template <typename It>
+    void assign(It first, It last);  //declaration
+
+    /** dtor - uses clear, which can free the pool at once */
+    ~bst() noexcept {clear();}
 
     // Move Semanticsb
     /** move ctor */
     //explicit bst(bst&& x) noexcept = default;
-    bst(bst&& x) noexcept: head{std::move(x.head)}, comp{std::move(x.comp)} {}
+    bst(bst&& x) noexcept: _pool{std::move(x._pool)}, head{std::move(x.head)}, comp{std::move(x.comp)},
+                           _size{std::exchange(x._size, 0)},
+                           _leftmost{std::exchange(x._leftmost, nullptr)},
+                           _rightmost{std::exchange(x._rightmost, nullptr)}, _auto{x._auto} {}
 
     /** move assignment */
     //bst& operator=(bst&& x) noexcept = default;
     bst& operator=(bst&& x) noexcept{
+        clear();                      // my nodes go back to my pool before it is replaced
+        _pool = std::move(x._pool);
         head = std::move(x.head);
         comp = std::move(x.comp);
+        _size = std::exchange(x._size, 0);
+        _leftmost = std::exchange(x._leftmost, nullptr);
+        _rightmost = std::exchange(x._rightmost, nullptr);
+        _auto = x._auto;
         return *this;
     }
 
     // Deep Copy Semantics
     /** deep copy ctor */
     bst(const bst& x) : comp {x.comp} {
+        _auto.threshold = x._auto.threshold;
         if (x.head) {
-            head.reset(new node{x.head, x.head->_parent});  //if x is not empty, we call node ctor recursively to copy it
+            _pool.reserve(x._size);     // with arena_alloc the copy is laid out in contiguous chunks
+            head = _copy(x.head.get());  //if x is not empty, we copy it node by node in our pool
+            _size = x._size;
+            comp.allocated(_size);
+            _refresh_bounds();
         }
     }
  
+    /** deep copy ctor - parallel
+     * as the copy ctor, the subtrees below the top levels of x being copied by `threads` threads
+     * if the pool can create nodes concurrently (heap_alloc); small trees are copied sequentially
+     */
+    bst(const bst& x, std::size_t threads) : comp {x.comp} {
+        _auto.threshold = x._auto.threshold;
+        if (x.head) {
+            _pool.reserve(x._size);
+            bool parallel = AP::concurrent_make && threads > 1 && x._size >= _parallel_cutoff;
+            head = parallel ? _copy_parallel(x.head.get(), threads) : _copy(x.head.get());
+            _size = x._size;
+            comp.allocated(_size);
+            _refresh_bounds();
+        }
+    }
+
     /** deep copy assignment */
     bst& operator=(const bst& x){
         clear();                  // clean my memory
@@ -152,68 +931,205 @@ class bst{
 
     /** function end
      * @return returns an iterator to one past the last node */
-    iterator end() noexcept {return iterator{nullptr};}
+    iterator end() noexcept {return iterator{nullptr, &_rightmost};}
 
     /** function end - const
     * @return returns a const_iterator to one past the last node */
-    const_iterator end() const noexcept {return const_iterator{nullptr};}
+    const_iterator end() const noexcept {return const_iterator{nullptr, &_rightmost};}
 
     /** function cend 
      *  @return returns an iterator to one past the last node */
-    const_iterator cend() const noexcept {return const_iterator{nullptr};}
+    const_iterator cend() const noexcept {return const_iterator{nullptr, &_rightmost};}
+
+    /** function rbegin 
+     * @return returns a reverse iterator to the last node (descending order) */
+    std::reverse_iterator<iterator> rbegin() noexcept {return std::reverse_iterator<iterator>{end()};}
+
+    /** function rbegin - const
+     * @return returns a const reverse iterator to the last node */
+    std::reverse_iterator<const_iterator> rbegin() const noexcept {return std::reverse_iterator<const_iterator>{end()};}
+
+    /** function crbegin 
+     * @return returns a const reverse iterator to the last node */
+    std::reverse_iterator<const_iterator> crbegin() const noexcept {return rbegin();}
+
+    /** function rend 
+     * @return returns a reverse iterator to one before the first node */
+    std::reverse_iterator<iterator> rend() noexcept {return std::reverse_iterator<iterator>{begin()};}
+
+    /** function rend - const
+     * @return returns a const reverse iterator to one before the first node */
+    std::reverse_iterator<const_iterator> rend() const noexcept {return std::reverse_iterator<const_iterator>{begin()};}
+
+    /** function crend 
+     * @return returns a const reverse iterator to one before the first node */
+    std::reverse_iterator<const_iterator> crend() const noexcept {return rend();}
 
     /** function find 
      *  finds a given key. If the key is present, returns an iterator to the proper node, otherwise returns 
      *  a nullptr, equivalent to output of function end() .
      *  @return returns an iterator to the key or iterator to one past the last node */
+    iterator find(const k_t& x) noexcept {return iterator{_find(x), &_rightmost};}
 
-    iterator find(const k_t& x) noexcept {
+    /** function find - const
+     *  @return returns a const_iterator to the key or iterator to one past the last node */
+    const_iterator find(const k_t& x) const noexcept {return const_iterator{_find(x), &_rightmost};}
 
-        auto tmp{head.get()};
-        while (tmp)  {            // traverse the bst until tmp is nullptr  
+    /** function find - heterogeneous
+     *  available only if OP is transparent: x can be of any type comparable with the keys
+     *  (e.g. a std::string_view or a const char* for std::string keys), no key is constructed
+     *  @return returns an iterator to the key or iterator to one past the last node */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    iterator find(const K& x) noexcept {return iterator{_find(x), &_rightmost};}
 
-            if(!comp(tmp->_pair.first,x) && !comp(x,tmp->_pair.first)){  //  key(x) == key(tmp) 
-                return iterator{tmp};
-                
-            }
-            else{                                  // otherwise move to the right or left child
-                if( comp(tmp->_pair.first,x) ){    
-                    tmp = tmp->_right.get();      // key(tmp) < key(x) --> traverse the right side of tree
-                }
-                else{ tmp = tmp->_left.get();}     // key(tmp) > key(x) --> traverse the left side of tree
-            }
-        
-        }
-        return end();   // calls "iterator end()" function - nullptr
+    /** function find - heterogeneous, const
+     *  @return returns a const_iterator to the key or iterator to one past the last node */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    const_iterator find(const K& x) const noexcept {return const_iterator{_find(x), &_rightmost};}
+
+    /** function find_batch 
+     *  looks up many keys at once: the lookups proceed together, level by level, and the next node
+     *  of each one is prefetched, so the cache misses of different keys overlap
+     *  @param first, last range of keys
+     *  @param out output iterator receiving, for every key, an iterator to its node or end()
+     *  @return returns out after the last iterator written */
+    template<typename InIt, typename OutIt>
+    OutIt find_batch(InIt first, InIt last, OutIt out) {
+        _find_batch(first, last, [&](node* n) {*out++ = iterator{n, &_rightmost};});
+        return out;
     }
 
+    /** function find_batch - const
+     *  @return returns out after the last const_iterator written */
+    template<typename InIt, typename OutIt>
+    OutIt find_batch(InIt first, InIt last, OutIt out) const {
+        _find_batch(first, last, [&](node* n) {*out++ = const_iterator{n, &_rightmost};});
+        return out;
+    }
 
-    /** function find - const
-     *  finds a given key. If the key is present, returns an iterator to the proper node, otherwise returns 
-     *  a nullptr, equivalent to output of function end() .
-     *  @return returns a const_iterator to the key or iterator to one past the last node */
+    /** function contains_batch 
+     *  as find_batch, writing to out true if the key is present and false otherwise
+     *  @return returns out after the last value written */
+    template<typename InIt, typename OutIt>
+    OutIt contains_batch(InIt first, InIt last, OutIt out) const {
+        _find_batch(first, last, [&](node* n) {*out++ = n != nullptr;});
+        return out;
+    }
 
-    const_iterator find(const k_t& x) const noexcept {
-        
-        auto tmp{head.get()};
-        while (tmp)  {            // traverse the bst until tmp is nullptr  
+    /** function contains 
+     *  @return returns true if there is a node with key x */
+    bool contains(const k_t& x) const noexcept {return _find(x) != nullptr;}
+
+    /** function contains - heterogeneous (only if OP is transparent)
+     *  @return returns true if there is a node with key x */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    bool contains(const K& x) const noexcept {return _find(x) != nullptr;}
+
+    /** function lower_bound 
+     *  @return returns an iterator to the first node whose key is not less than x, end() if there is none */
+    iterator lower_bound(const k_t& x) noexcept {return iterator{_lower(x), &_rightmost};}
+
+    /** function lower_bound - const
+     *  @return returns a const_iterator to the first node whose key is not less than x, end() if there is none */
+    const_iterator lower_bound(const k_t& x) const noexcept {return const_iterator{_lower(x), &_rightmost};}
+
+    /** function upper_bound 
+     *  @return returns an iterator to the first node whose key is greater than x, end() if there is none */
+    iterator upper_bound(const k_t& x) noexcept {return iterator{_upper(x), &_rightmost};}
+
+    /** function upper_bound - const
+     *  @return returns a const_iterator to the first node whose key is greater than x, end() if there is none */
+    const_iterator upper_bound(const k_t& x) const noexcept {return const_iterator{_upper(x), &_rightmost};}
+
+    /** function lower_bound - heterogeneous (only if OP is transparent) */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    iterator lower_bound(const K& x) noexcept {return iterator{_lower(x), &_rightmost};}
+
+    /** function lower_bound - heterogeneous, const */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    const_iterator lower_bound(const K& x) const noexcept {return const_iterator{_lower(x), &_rightmost};}
+
+    /** function upper_bound - heterogeneous (only if OP is transparent) */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    iterator upper_bound(const K& x) noexcept {return iterator{_upper(x), &_rightmost};}
+
+    /** function upper_bound - heterogeneous, const */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    const_iterator upper_bound(const K& x) const noexcept {return const_iterator{_upper(x), &_rightmost};}
+
+    /** function equal_range 
+     *  keys are unique, so the range contains at most one node (one descent and one increment)
+     *  @return returns the pair lower_bound(x), upper_bound(x) */
+    std::pair<iterator, iterator> equal_range(const k_t& x) noexcept {return _equal_range<iterator>(x);}
+
+    /** function equal_range - const
+     *  @return returns the pair lower_bound(x), upper_bound(x) as const_iterators */
+    std::pair<const_iterator, const_iterator> equal_range(const k_t& x) const noexcept {return _equal_range<const_iterator>(x);}
+
+    /** function equal_range - heterogeneous (only if OP is transparent) */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    std::pair<iterator, iterator> equal_range(const K& x) noexcept {return _equal_range<iterator>(x);}
+
+    /** function equal_range - heterogeneous, const */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    std::pair<const_iterator, const_iterator> equal_range(const K& x) const noexcept {return _equal_range<const_iterator>(x);}
+
+    /** function range 
+     *  view of the nodes with key in [lo, hi), to be used in a range-based for loop:
+     *  it costs one descent per bound, O(log n) on a balanced tree, then O(1) amortized per node
+     *  @return returns the pair of iterators lower_bound(lo), lower_bound(hi) */
+    _range<iterator> range(const k_t& lo, const k_t& hi) noexcept {
+        return _range<iterator>{lower_bound(lo), _range_end<iterator>(lo, hi)};
+    }
 
-            if(!comp(tmp->_pair.first,x) && !comp(x,tmp->_pair.first)){  //  key(x) == key(tmp) 
-                return iterator{tmp};
-                
-            }
-            else{                                  // otherwise move to the right or left child
-                if( comp(tmp->_pair.first,x) ){    
-                    tmp = tmp->_right.get();      // key(tmp) < key(x) --> traverse the right side of tree
-                }
-                else{ tmp = tmp->_left.get();}     // key(tmp) > key(x) --> traverse the left side of tree
-            }
-        }
-        return end();   // calls "iterator end()" function - nullptr
+    /** function range - const
+     *  @return returns the pair of const_iterators lower_bound(lo), lower_bound(hi) */
+    _range<const_iterator> range(const k_t& lo, const k_t& hi) const noexcept {
+        return _range<const_iterator>{lower_bound(lo), _range_end<const_iterator>(lo, hi)};
     }
 
-       
+    /** function nth
+     *  available only with the order_statistics policy: one descent, O(height)
+     *  @return returns an iterator to the node with the k-th smallest key (from 0), end() if k >= size() */
+    iterator nth(std::size_t k) noexcept {return iterator{_nth(k), &_rightmost};}
+
+    /** function nth - const
+     *  @return returns a const_iterator to the node with the k-th smallest key, end() if k >= size() */
+    const_iterator nth(std::size_t k) const noexcept {return const_iterator{_nth(k), &_rightmost};}
+
+    /** function rank
+     *  available only with the order_statistics policy: one descent, O(height)
+     *  @return returns the number of keys less than x (the position of x, if present) */
+    std::size_t rank(const k_t& x) const noexcept {return _rank(x);}
+
+    /** function count_range
+     *  available only with the order_statistics policy: two descents, O(height)
+     *  @return returns the number of keys in [lo, hi), as visited by range(lo, hi) */
+    std::size_t count_range(const k_t& lo, const k_t& hi) const noexcept {
+        return comp(lo, hi) ? _rank(hi) - _rank(lo) : 0;
+    }
 
+    /** function for_each_parallel
+     * calls f(key, value) for every node, with `threads` threads: the nodes of the top levels and
+     * the subtrees below them are independent tasks, so f is called concurrently and in no
+     * particular order (the keys of a subtree are visited in order); small trees are visited sequentially
+     * @param f --> callable with (const k_t&, v_t&), safe to call from several threads at once
+     * @param threads --> number of threads, the calling one included
+     */
+    template<typename F>
+    void for_each_parallel(F&& f, std::size_t threads = hardware_threads()) {
+        auto visit = [&f](node* n) {f(static_cast<const k_t&>(n->_pair.first), n->_pair.second);};
+        _for_each_parallel(visit, threads);
+    }
+
+    /** function for_each_parallel - const
+     * @param f --> callable with (const k_t&, const v_t&), safe to call from several threads at once
+     */
+    template<typename F>
+    void for_each_parallel(F&& f, std::size_t threads = hardware_threads()) const {
+        auto visit = [&f](const node* n) {f(n->_pair.first, n->_pair.second);};
+        _for_each_parallel(visit, threads);
+    }
        
     /** function emplace 
      * inserts a new element into the container constructed in-place
@@ -227,8 +1143,58 @@ class bst{
         return insert(std::pair<k_t,v_t>{std::forward<Types>(args)...});  
     }
 
-    /** Clears the content of the tree */
-    void clear() noexcept {head.reset();} 
+    /** function emplace_hint 
+     * like emplace, but the position of the new node is searched next to hint first (see insert with hint)
+     * @return an iterator to the node with the key (new or already present)
+     */
+    template <typename... Types >
+    iterator emplace_hint(iterator hint, Types&&... args){
+        return insert(hint, std::pair<k_t,v_t>{std::forward<Types>(args)...});
+    }
+
+    /** function try_emplace 
+     * if there is no element with key x, inserts a new element with key x and value
+     * constructed in-place from args; otherwise it does nothing (args are not moved from)
+     * the tree is descended once and a node is created only if the key is missing
+     * 
+     * @param x the key of the node (copied or moved into the node)
+     * @param args arguments for the constructor of the value
+     * @return a pair of an iterator (pointing to the node with key x) and a bool (true if inserted)
+     */
+    template <typename K, typename... Types >
+    std::pair<iterator,bool> try_emplace(K&& x, Types&&... args){
+        if constexpr (!_is_transparent<OP>::value && !std::is_same_v<std::decay_t<K>, k_t>) {
+            return try_emplace(k_t(std::forward<K>(x)), std::forward<Types>(args)...);   // build the key once
+        }
+        else {
+            auto scope = comp.scope(_counted_op::insert);
+            auto pos = _locate(x);       // with a transparent OP, the key is built only if inserted
+            if (pos.found) {
+                return std::pair<iterator,bool>{iterator{pos.found, &_rightmost}, false};
+            }
+            auto new_node = _make_node(std::piecewise_construct,
+                                       std::forward_as_tuple(std::forward<K>(x)),
+                                       std::forward_as_tuple(std::forward<Types>(args)...));
+            comp.allocated(1);
+            return std::pair<iterator,bool>{iterator{_attach(pos, std::move(new_node)), &_rightmost}, true};
+        }
+    }
+
+    /** Clears the content of the tree 
+     * if the pool supports it, the pairs need no destructor and the pool holds only the nodes of this tree,
+     * the chunks are freed at once
+     * without visiting the nodes, otherwise the nodes are destroyed iteratively */
+    void clear() noexcept {
+        if constexpr (AP::bulk_release && std::is_trivially_destructible_v<std::pair<k_t,v_t>>) {
+            if (_pool.exclusive(_size)) {    // no node of the pool is in another tree (see split)
+                head.release();              // the nodes are forgotten,
+                _pool.release_all();         // then their storage is freed
+            }
+        }
+        _destroy(head);                      // nothing left to do after release_all
+        _size = 0;
+        _leftmost = _rightmost = nullptr;
+    } 
     
 
 
@@ -237,6 +1203,13 @@ class bst{
      * @param x l-value reference of the key of the node to be deleted */
     void erase(const k_t& x);         //declaration
 
+    /** function erase - heterogeneous 
+     * available only if OP is transparent; no key is constructed
+     * @param x key (of any type comparable with the keys) of the node to be deleted
+     * @return returns the number of removed nodes (0 or 1) */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    std::size_t erase(const K& x) noexcept {return _erase(x) ? 1 : 0;}
+
 
     /**  put-to operator*/
     friend                                    // friend since is_empty is private
@@ -249,7 +1222,7 @@ class bst{
         for(auto& key : x){
             os << key << " ";
         }
-        os << std::endl;
+        os << '\n';                   // no flush: see export_records for large trees
         return os;
     }
 
@@ -257,42 +1230,26 @@ class bst{
      /** subscripting operator 
      * Returns a reference to the value that is mapped
      * to a key equivalent to x, performing an insertion if such key does not already exist
+     * (one descent of the tree, see try_emplace)
      * @param x l-value reference to the key
      * @return reference to the value of the node
      */
-    v_t& operator[](const k_t& x) noexcept {
-         
-        if(find(x) != iterator{nullptr}){   // if the key is already present
-            auto address = find(x);         // we return the associated value
-            return address.value();
-        }
-       
-        auto def_value = v_t{};                   // otherwise we insert a new key with requested k_t and default v_t
-        auto new_node = emplace(x,def_value);     // emplace uses insert function
-        return new_node.first.value();         // function value is defined in class _iterator which returns the value 
-                                               // of the node pointed to by iterator
+    v_t& operator[](const k_t& x) {
+        return try_emplace(x).first.value();    // function value is defined in class _iterator which returns the value 
+                                                // of the node pointed to by iterator
     }
 
 
     /** subscripting operator 
      * Returns a reference to the value that is mapped
      * to a key equivalent to x, performing an insertion if such key does not already exist
-     * @param x r-value reference to the key
+     * (one descent of the tree, see try_emplace)
+     * @param x r-value reference to the key, moved into the new node if any
      * @return reference to the value of the node
      */
 
-    v_t& operator[](k_t&& x) noexcept {        //non-const because of rvalue
-
-        auto tmp{std::move(x)};
-        if(find(tmp) != iterator{nullptr}){   // if the key is already present
-            auto address = find(tmp);         // we return the associated value
-            return address.value();
-        }
-     
-        auto def_value = v_t{};            // otherwise we insert a new key withe requested k_t nad default v_t
-        auto new_node = emplace(tmp,def_value);     // emplace uses insert function
-        return new_node.first.value();           // function value is defined in class _iterator which returns the value 
-                                               // of the node pointed to by iterator
+    v_t& operator[](k_t&& x) {        //non-const because of rvalue
+        return try_emplace(std::move(x)).first.value();
     }
 };
 
@@ -305,219 +1262,1190 @@ class bst{
 
 /** private function _insert 
 * is used to insert a new node in the tree 
-* the bool is true if a new node has been allocated, false otherwise (i.e. the key already exists) 
+* the tree is descended once; the node is created (and x moved) only if the key is missing
 * @return returns a pair of an iterator (pointing to the node) and a bool. 
 */
-template<typename k_t, typename v_t, typename OP>
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
 template <typename O>
-std::pair<typename bst<k_t, v_t, OP >::iterator, bool>   bst<k_t, v_t,OP> :: _insert (O&& x) {  //forwarding reference
-        
-    auto tmp = head.get();
-    auto new_node{new node{std::forward<O>(x)}};
+std::pair<typename bst<k_t, v_t, OP, BP, AP>::iterator, bool>   bst<k_t, v_t, OP, BP, AP> :: _insert (O&& x) {  //forwarding reference
 
-    // base case: empty bst --> the new node is added
-    if(!head){
-        head.reset(new_node);
-        return std::pair<iterator, bool>{iterator{new_node},true};
-    }
+    auto scope = comp.scope(_counted_op::insert);
+    auto pos = _locate(x.first);
 
     // if a node with the same key is already present,
     //return an iterator to that node and flag false for new insertion
-    if (find(x.first)!=iterator{nullptr}){    
-        return  std::pair<iterator, bool>{find(x.first), false}; 
-    }
-
-        
-    // other than the above two cases, we search the tree to find
-    // the location of the new node, on the left or on the right
-    else{
-        while(tmp){                                  
-            new_node->_parent = tmp; 
-                // go right                            //tmp is the parent of the new node.
-            if( comp(tmp->_pair.first, x.first) ){     //if the key of tmp is less than the key of x
-                if(!tmp->_right.get()){                // and if there is no node on the right hand side of tmp
-                    tmp->_right.reset(new_node);       // we put the new node on the right of tmp,
-                    tmp = nullptr;                   
-                }
-                else{tmp = tmp->_right.get();}     // otherwise we update tmp as the node on its right hand side
-            }
-            else{  //go left
-                if(!tmp->_left.get()){           //if the key of tmp is greater than the key of x,
-                    tmp->_left.reset(new_node);  //we do the same seeking on the left side of tree
-                    tmp = nullptr;
-                }
-                else{tmp = tmp->_left.get();}   // otherwise we update tmp as the node on its left hand side
-            }
-        }
-           
+    if (pos.found) {
+        return std::pair<iterator, bool>{iterator{pos.found, &_rightmost}, false}; 
     }
-    return std::pair<iterator, bool>{iterator{new_node}, true};
+
+    // otherwise the new node is attached where the descent stopped
+    comp.allocated(1);
+    auto new_node = _attach(pos, _make_node(std::forward<O>(x)));
+    return std::pair<iterator, bool>{iterator{new_node, &_rightmost}, true};
 }
 
 
 
 
-// definition of function make_balance - out of the class
+// definition of function insert - node handle - out of the class bst
 
-/** @brief private function make_balance 
- * is used to balance the tree
-  *  @param v --> vector of pairs
-  *  @param start --> first index
-  *  @param end --> last index
-  */
-template<typename k_t, typename v_t, typename OP>
-template <typename P>
-void bst<k_t, v_t, OP>::make_balance (std::vector<P> v, int start, int end){
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+std::pair<typename bst<k_t, v_t, OP, BP, AP>::iterator, bool> bst<k_t, v_t, OP, BP, AP>::insert (node_type&& nh){
 
-    // base Case 
-    if (start > end) {
-        return;
-    } 
-  
-    // get the median element 
-    int median = (start + end)/2; 
-    
-    insert(v[median]);
-    make_balance(v, start, median-1);
-    make_balance(v, median+1,  end);
-    return ;
+    if (nh.empty()) {
+        return std::pair<iterator, bool>{end(), false};
+    }
+    auto scope = comp.scope(_counted_op::insert);
+    auto pos = _locate(nh.key());
+    if (pos.found) {
+        return std::pair<iterator, bool>{iterator{pos.found, &_rightmost}, false};
+    }
+
+    node_ptr n;
+    if (_pool.owns(nh._ptr.get())) {
+        n = std::move(nh._ptr);
+    }
+    else {
+        comp.allocated(1);
+        n = _make_node(std::move(nh._ptr->_pair));
+        nh._ptr.reset();
+    }
+    static_cast<typename BP::meta&>(*n) = typename BP::meta{};       // a new leaf
+    return std::pair<iterator, bool>{iterator{_attach(pos, std::move(n)), &_rightmost}, true};
 }
 
 
 
-// definition of function balance - out of the class
 
-/** function to balance the tree - uses the private function make_balance 
- * it traverse the bst inorder and stores all the pairs in a vector v;
- * then clears the tree and insert the nodes
- * starting from the median of v and again recursively on the left and right subvectors of v
- */
-template<typename k_t, typename v_t, typename OP>
-void bst<k_t, v_t, OP >:: balance(){
+// definition of function _locate_hint - out of the class bst
 
-    std::vector<std::pair<k_t,v_t>> v;
+/** private function _locate_hint
+ * checks if x belongs just before or just after hint, using the parent pointers to find the
+ * neighbour of hint; otherwise it descends from the root like _locate
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+typename bst<k_t, v_t, OP, BP, AP>::_position bst<k_t, v_t, OP, BP, AP> :: _locate_hint(node* hint, const k_t& x) const noexcept {
 
-    // fill v with inorder elements of the bst
-    for(const_iterator i = cbegin(); i != cend() ; ++i){
-        v.emplace_back(*i, i.value());
+    if (!hint) {                                                 // end(): x should follow the last node
+        if (_rightmost && comp(_rightmost->_pair.first, x)) {
+            return _position{nullptr, _rightmost, false};
+        }
+    }
+    else if (comp(x, hint->_pair.first)) {                       // x < hint: x should follow the previous node
+        node* prev = hint == _leftmost ? nullptr : (--iterator{hint, &_rightmost}).current_ptr();
+        if (!prev || comp(prev->_pair.first, x)) {
+            // either hint has no left child, or prev (right most node of that subtree) has no right child
+            return hint->_left ? _position{nullptr, prev, false} : _position{nullptr, hint, true};
+        }
+    }
+    else if (comp(hint->_pair.first, x)) {                       // hint < x: x should precede the next node
+        node* next = hint == _rightmost ? nullptr : (++iterator{hint, &_rightmost}).current_ptr();
+        if (!next || comp(x, next->_pair.first)) {
+            // either hint has no right child, or next (left most node of that subtree) has no left child
+            return hint->_right ? _position{nullptr, next, true} : _position{nullptr, hint, false};
+        }
+    }
+    else {                                                       // same key as hint
+        return _position{hint, hint->_parent, false};
     }
-        
-    // clear the bst (*this) 
-    clear();
-    // rebuild the bst
-    make_balance(v, 0, v.size()-1);
-    return;
+    return _locate(x);                                           // wrong hint
 }
 
 
 
 
+// definition of function make_vine - out of the class
 
-// definition of function erase - out of class bst
+/** @brief private function make_vine 
+ * turns the tree into a vine (every node has only a right child) with right rotations
+ * @return returns the number of nodes
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+std::size_t bst<k_t, v_t, OP, BP, AP>::make_vine () noexcept{
 
-/** function erase  
-* removes the element (if one exists) with the key equivalent to key.
-* @param x l-value reference of the key of the node to be deleted */
+    std::size_t size = 0;
+    auto tmp = head.get();
+    while (tmp) {
+        if (tmp->_left) {                               // rotate the left child on top of tmp 
+            tmp = _rotate_right<no_balance>(head, tmp);  // the policy data is recomputed at the end
+        }
+        else {                                          // tmp is in its final place in the vine
+            ++size;
+            tmp = tmp->_right.get();
+        }
+    }
+    return size;
+}
 
-template<typename k_t, typename v_t, typename OP>   
-void bst<k_t, v_t, OP> :: erase(const k_t& x) {
-    
-    if(find(x)!=iterator{nullptr}){       // if the key is present in the bst - (or --> != end() ) 
-
-        node* starting_node = find(x).current_ptr();     // starting_node points to the node x which we want to delete;
-        // possible cases
-        // 1: the node is a leaf (no child)
-        if(!starting_node->_left && !starting_node->_right){   // if the node x has no child             
-           
-            auto key_of_parent = starting_node->_parent->_pair.first;
-            auto parent = starting_node->_parent;                 // ptr to parent node
-            
-            if(comp(x,key_of_parent))  {   // if key(x) < key(its parent) --> x is a left child of its parent
-                parent->_left.release();   // we release and reset the pointer to the left child of parent (x)
-                parent->_left.reset();     // reset to nullptr
-            } 
-            else{                          // otherwise x is a right child of its parent  
-                parent->_right.release();
-                parent->_right.reset();     // reset to nullptr
-            }
-        } 
-        
-
-        // 2: the node has only one child
-        if((!starting_node->_left && starting_node->_right) || (starting_node->_left && !starting_node->_right)) {        // if the node x has only one child
-        
-            if(starting_node->_left){                                // if x has a left child
-                
-                auto left_child = starting_node->_left.release();    // ptr to the unique left child
-                auto parent = starting_node->_parent;                // ptr to parent node
-                auto key_of_parent = parent->_pair.first;
-
-                if(comp(x,key_of_parent)) {      // if key(x) < key(its parent) --> x is a left child of its parent
-                    parent->_left.release();
-                    parent->_left.reset(left_child);   // reset the left pointer of parent of x to left child of x (not x itself anymore)
-                    left_child->_parent = parent;
-                }  
-                else{                               // otherwise x is a right child  of its parent
-                    parent->_right.release();
-                    parent->_right.reset(left_child); 
-                    left_child->_parent = parent;
-                    
-                } 
-                                
-            }
-            else{                                                      // if x has a right child
-                auto right_child = starting_node->_right.release();    // ptr to unique right child
-                auto parent = starting_node->_parent;                   // ptr to parent node
-                auto key_of_parent = parent->_pair.first;
-
-                if(comp(x,key_of_parent)) {          // if key(x) < key(its parent) --> x is a left child of its parent
-                    parent->_left.release();
-                    parent->_left.reset(right_child);  // reset the left pointer of parent of x to left child of x (not x itself anymore)
-                    right_child->_parent = parent;
-                }
-                else {                                // otherwise x is a right child  of its parent
-                    parent->_right.release();
-                    parent->_right.reset(right_child);
-                    right_child->_parent = parent;
-                }              
-            }
-        }
-
-        //3: the node has two children
-        if(starting_node->_left && starting_node->_right){      // x has either a right and a left child
-            
-            auto swap_node = starting_node->_right.get();      //swap_node is the right child of x
-            while(swap_node->_left){                           //if there is a left child for swap_node, go to it  
-                swap_node = swap_node->_left.get();            //and update swap_node to its left child
-            }
-            
-            starting_node->_pair = swap_node->_pair;       // exchange keys and values 
-            if(swap_node->_parent != starting_node){       // swap_node is not the child of node to be deleted
-                if(swap_node->_right){                      // and has a right child
-                    swap_node->_right->_parent = swap_node->_parent;
-                }
 
-                auto tmp = swap_node->_right.release(); 
-                swap_node->_parent->_left.reset(tmp);    // attach the subtree to the parent
-                
+// definition of function compress - out of the class
+
+/** @brief private function compress 
+ * applies a left rotation to count nodes of the right spine, one every two
+ * @param count --> number of rotations
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+void bst<k_t, v_t, OP, BP, AP>::compress (std::size_t count) noexcept{
+
+    auto tmp = head.get();
+    for (std::size_t i = 0; i < count; ++i) {
+        tmp = _rotate_left<no_balance>(head, tmp);   // tmp goes down to the left of its right child
+        tmp = tmp->_right.get();                     // next node of the spine
+    }
+}
+
+
+// definition of function _update_all - out of the class
+
+/** @brief private function _update_all 
+ * recomputes the policy data of every node in post-order, using the parent pointers
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+void bst<k_t, v_t, OP, BP, AP>::_update_all () noexcept{
+
+    if constexpr (BP::retrace) {
+        // first node in post-order of the subtree rooted at x
+        auto first_leaf = [](node* x) noexcept {
+            while (x->_left || x->_right) {
+                x = x->_left ? x->_left.get() : x->_right.get();
             }
-            else{                                          // swap_node is the child of node to be deleted
-                if(swap_node->_right){                 
-                    swap_node->_right->_parent = starting_node;
-                }
+            return x;
+        };
+
+        node* tmp = head ? first_leaf(head.get()) : nullptr;
+        while (tmp) {
+            BP::update(tmp);                              // both children have already been visited
+            node* parent = tmp->_parent;
+            if (parent && parent->_left.get() == tmp && parent->_right) {
+                tmp = first_leaf(parent->_right.get());   // the right sibling comes before the parent
+            }
+            else {
+                tmp = parent;
+            }
+        }
+    }
+}
+
+
+// definition of function _copy - out of the class
+
+/** private function _copy 
+ * deep copy of the subtree rooted at x, in pre-order and without recursion:
+ * src walks the original, dst walks the copy, both go back up through the parent pointers
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+typename bst<k_t, v_t, OP, BP, AP>::node_ptr bst<k_t, v_t, OP, BP, AP>::_copy (const node* x){
+
+    using meta = typename BP::meta;
+
+    node_ptr root = _make_node(x->_pair);
+    static_cast<meta&>(*root) = static_cast<const meta&>(*x);   // same shape, same data
+
+    const node* src = x;
+    node* dst = root.get();
+    try {
+        while (src) {
+            if (src->_left && !dst->_left) {             // copy the left child and go down
+                dst->_left = _make_node(src->_left->_pair);
+                dst->_left->_parent = dst;
+                src = src->_left.get();
+                dst = dst->_left.get();
+            }
+            else if (src->_right && !dst->_right) {      // then the right child
+                dst->_right = _make_node(src->_right->_pair);
+                dst->_right->_parent = dst;
+                src = src->_right.get();
+                dst = dst->_right.get();
+            }
+            else {                                       // both subtrees done: go back up
+                static_cast<meta&>(*dst) = static_cast<const meta&>(*src);
+                src = src == x ? nullptr : src->_parent;
+                dst = dst->_parent;
+            }
+        }
+    }
+    catch (...) {
+        _destroy(root);
+        throw;
+    }
+    return root;
+}
+
+
+// definition of function _destroy - out of the class
+
+/** private function _destroy 
+ * goes down to a leaf, deletes it and continues from its parent
+ * every node is reached once going down and left once going up
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+void bst<k_t, v_t, OP, BP, AP>::_destroy (node_ptr& root) noexcept{
+
+    node* top = root.get();
+    node* tmp = top;
+    while (tmp) {
+        if (tmp->_left) {
+            tmp = tmp->_left.get();
+        }
+        else if (tmp->_right) {
+            tmp = tmp->_right.get();
+        }
+        else if (tmp == top) {                       // the last node left
+            root.reset();
+            tmp = nullptr;
+        }
+        else {                                       // a leaf: its parent deletes it
+            node* parent = tmp->_parent;
+            (parent->_left.get() == tmp ? parent->_left : parent->_right).reset();
+            tmp = parent;
+        }
+    }
+}
+
+
+// definition of function _build - out of the class
+
+/** @brief private function _build 
+ * builds a balanced subtree with the next n pairs of a sorted range
+ * the recursion depth is log2(n)
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+template <typename It>
+typename bst<k_t, v_t, OP, BP, AP>::node_ptr bst<k_t, v_t, OP, BP, AP>::_build (std::size_t n, It& first){
+
+    // base case 
+    if (n == 0) {
+        return node_ptr{};
+    }
+
+    std::size_t left_size = (n - 1) / 2;         // the right subtree gets the extra node, if any
+    auto left = _build(left_size, first);
+
+    node_ptr x = _make_node(*first);
+    ++first;
+    x->_left = std::move(left);
+    if (x->_left) {
+        x->_left->_parent = x.get();
+    }
+    x->_right = _build(n - 1 - left_size, first);
+    if (x->_right) {
+        x->_right->_parent = x.get();
+    }
+
+    BP::update(x.get());
+    return x;
+}
+
+
+// definition of function _build_from - out of the class
+
+/** @brief private function _build_from 
+ * builds a balanced subtree with the pairs at positions [lo, lo + n), the middle one at the root
+ * the recursion depth is log2(n)
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+template <typename Make>
+typename bst<k_t, v_t, OP, BP, AP>::node_ptr bst<k_t, v_t, OP, BP, AP>::_build_from (std::size_t lo, std::size_t n, Make& make){
+
+    if (n == 0) {
+        return node_ptr{};
+    }
+
+    std::size_t left_size = (n - 1) / 2;         // same shape as _build
+    node_ptr x = make(lo + left_size);
+    x->_left = _build_from(lo, left_size, make);
+    if (x->_left) {
+        x->_left->_parent = x.get();
+    }
+    x->_right = _build_from(lo + left_size + 1, n - 1 - left_size, make);
+    if (x->_right) {
+        x->_right->_parent = x.get();
+    }
+
+    BP::update(x.get());
+    return x;
+}
+
+
+// definition of function _build_parallel - out of the class
+
+/** @brief private function _build_parallel 
+ * the top levels are built first, leaving empty the links to the subtrees below them;
+ * every task builds one subtree and stores it in its link (different links: no synchronization);
+ * at the end the policy data of the top nodes is recomputed, children before parents
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+template <typename Make>
+typename bst<k_t, v_t, OP, BP, AP>::node_ptr bst<k_t, v_t, OP, BP, AP>::_build_parallel (std::size_t n, Make& make, std::size_t threads){
+
+    struct task {
+        std::size_t lo;       // first position of the subtree
+        std::size_t n;        // number of nodes of the subtree
+        node_ptr* link;       // where the subtree is stored
+        node* parent;
+    };
+
+    std::size_t levels = _split_levels(threads);
+    std::vector<task> tasks;
+    std::vector<node*> top;                      // nodes of the top levels, in pre-order
+    tasks.reserve(std::size_t{1} << levels);
+    top.reserve(std::size_t{1} << levels);
+
+    node_ptr root;
+    try {
+        auto build_top = [&](auto& self, std::size_t lo, std::size_t n, std::size_t level, node_ptr& link, node* parent) -> void {
+            if (n == 0) {
+                return;
+            }
+            if (level == levels) {
+                tasks.push_back(task{lo, n, &link, parent});
+                return;
+            }
+            std::size_t left_size = (n - 1) / 2;
+            link = make(lo + left_size);
+            link->_parent = parent;
+            top.push_back(link.get());
+            self(self, lo, left_size, level + 1, link->_left, link.get());
+            self(self, lo + left_size + 1, n - 1 - left_size, level + 1, link->_right, link.get());
+        };
+        build_top(build_top, 0, n, 0, root, nullptr);
+
+        _parallel_for(threads, tasks.size(), [&](std::size_t i) {
+            auto& t = tasks[i];
+            *t.link = _build_from(t.lo, t.n, make);
+            (*t.link)->_parent = t.parent;
+        });
+    }
+    catch (...) {
+        _destroy(root);
+        throw;
+    }
+
+    for (auto it = top.rbegin(); it != top.rend(); ++it) {
+        BP::update(*it);
+    }
+    return root;
+}
+
+
+// definition of function _copy_parallel - out of the class
+
+/** private function _copy_parallel 
+ * copies the top levels of the subtree rooted at x, then every subtree below them with _copy,
+ * one task each; the policy data is copied with the nodes (same shape)
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+typename bst<k_t, v_t, OP, BP, AP>::node_ptr bst<k_t, v_t, OP, BP, AP>::_copy_parallel (const node* x, std::size_t threads){
+
+    using meta = typename BP::meta;
+
+    struct task {
+        const node* src;      // root of the subtree to copy
+        node_ptr* link;       // where the copy is stored
+        node* parent;
+    };
+
+    std::size_t levels = _split_levels(threads);
+    std::vector<task> tasks;
+
+    node_ptr root;
+    try {
+        auto copy_top = [&](auto& self, const node* src, std::size_t level, node_ptr& link, node* parent) -> void {
+            if (level == levels) {
+                tasks.push_back(task{src, &link, parent});
+                return;
+            }
+            link = _make_node(src->_pair);
+            static_cast<meta&>(*link) = static_cast<const meta&>(*src);
+            link->_parent = parent;
+            if (src->_left) {
+                self(self, src->_left.get(), level + 1, link->_left, link.get());
+            }
+            if (src->_right) {
+                self(self, src->_right.get(), level + 1, link->_right, link.get());
+            }
+        };
+        copy_top(copy_top, x, 0, root, nullptr);
+
+        _parallel_for(threads, tasks.size(), [&](std::size_t i) {
+            auto& t = tasks[i];
+            *t.link = _copy(t.src);
+            (*t.link)->_parent = t.parent;
+        });
+    }
+    catch (...) {
+        _destroy(root);
+        throw;
+    }
+    return root;
+}
+
+
+// definition of function _is_sorted_unique - out of the class
+
+/** @brief private function _is_sorted_unique 
+ * @return returns true if the keys of the range are strictly increasing
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+template <typename It>
+bool bst<k_t, v_t, OP, BP, AP>::_is_sorted_unique (It first, It last) const{
+
+    if (first == last) {
+        return true;
+    }
+    for (auto next = std::next(first); next != last; ++first, ++next) {
+        if (!comp((*first).first, (*next).first)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// definition of function assign - out of the class
+
+/** function assign 
+ * replaces the content of the tree with the pairs in [first, last)
+ * already sorted ranges are built directly, the others are sorted in a buffer first
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+template <typename It>
+void bst<k_t, v_t, OP, BP, AP>::assign (It first, It last){
+
+    using category = typename std::iterator_traits<It>::iterator_category;
+
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+        if (_is_sorted_unique(first, last)) {          // second pass only for forward ranges
+            assign(sorted_unique, first, last);
+            return;
+        }
+    }
+
+    std::vector<std::pair<k_t,v_t>> v(first, last);
+    auto less_key = [this](const auto& a, const auto& b) {return comp(a.first, b.first);};
+    std::stable_sort(v.begin(), v.end(), less_key);    // stable: the first pair with a key is kept
+    auto last_unique = std::unique(v.begin(), v.end(), [&less_key](const auto& a, const auto& b) {
+        return !less_key(a, b);                        // sorted: !(a < b) means a == b
+    });
+
+    assign(sorted_unique, std::make_move_iterator(v.begin()), std::make_move_iterator(last_unique));
+}
+
+
+// definition of function assign - out of the class
+
+/** function assign - sorted, parallel
+ * the node of position i is made from first[i], so the tasks need random access to the range
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+template <typename It>
+void bst<k_t, v_t, OP, BP, AP>::assign (sorted_unique_t, It first, It last, std::size_t threads){
+
+    using category = typename std::iterator_traits<It>::iterator_category;
+
+    if constexpr (AP::concurrent_make && std::is_base_of_v<std::random_access_iterator_tag, category>) {
+        auto n = static_cast<std::size_t>(last - first);
+        if (threads > 1 && n >= _parallel_cutoff) {
+            clear();
+            auto make = [this, first](std::size_t i) {return _make_node(first[i]);};
+            head = _build_parallel(n, make, threads);
+            _size = n;
+            comp.allocated(n);
+            _refresh_bounds();
+            return;
+        }
+    }
+    assign(sorted_unique, first, last);
+}
+
+
+// definition of function save - out of the class
+
+/** function save 
+ * flat layout: the snapshot of freeze() is written as it is; records: header, then the pairs in order
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+void bst<k_t, v_t, OP, BP, AP>::save (const std::string& path) const{
+
+    if constexpr (serializer<k_t>::flat && serializer<v_t>::flat) {
+        freeze().save(path);
+    }
+    else {
+        auto h = _make_header<k_t, v_t>(_size, false);
+        auto os = _open_output(path);
+        os.write(reinterpret_cast<const char*>(&h), sizeof h);
+        for (auto it = begin(); it != end(); ++it) {
+            serializer<k_t>::write(os, *it);
+            serializer<v_t>::write(os, it.value());
+        }
+        _close_output(os, path);
+    }
+}
+
+
+// definition of function load - out of the class
+
+/** function load 
+ * flat layout: the nodes are built reading the mapped snapshot in order;
+ * records: the pairs are parsed in a buffer first, so a truncated file leaves the tree unchanged
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+void bst<k_t, v_t, OP, BP, AP>::load (const std::string& path){
+
+    if constexpr (serializer<k_t>::flat && serializer<v_t>::flat) {
+        auto frozen = frozen_bst<k_t, v_t, OP>::load(path, comp.op);
+        clear();
+        _pool.reserve(frozen.size());
+        _frozen_pairs first{frozen.begin()};
+        head = _build(frozen.size(), first);
+        _size = frozen.size();
+        comp.allocated(_size);
+        _refresh_bounds();
+    }
+    else {
+        _file_mapping file{path};
+        auto h = file.header<k_t, v_t>(path);
+        if (h.flat) {
+            throw std::runtime_error(path + " was saved with flat key and value types");
+        }
+        const char* p = file.data() + sizeof h;
+        const char* end = file.data() + file.size();
+        std::vector<std::pair<k_t, v_t>> pairs;
+        pairs.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(h.count, file.size())));
+        for (std::uint64_t i = 0; i < h.count; ++i) {
+            auto key = serializer<k_t>::read(p, end);
+            pairs.emplace_back(std::move(key), serializer<v_t>::read(p, end));
+        }
+        assign(sorted_unique, std::make_move_iterator(pairs.begin()), std::make_move_iterator(pairs.end()));
+    }
+}
+
+
+// definition of function export_records - out of the class
+
+/** function export_records 
+ * one record per node, in order
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+template<typename Sink>
+void bst<k_t, v_t, OP, BP, AP>::export_records (Sink&& sink, record_format format) const{
+
+    _record_writer<std::remove_reference_t<Sink>> out{sink, format};
+    for (auto it = begin(); it != end(); ++it) {
+        out.record(*it, it.value());
+    }
+    out.flush();
+}
+
+
+// definition of function import_records - out of the class
+
+/** function import_records 
+ * the records are parsed in a buffer first, so a malformed input leaves the tree unchanged
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+template<typename Source>
+void bst<k_t, v_t, OP, BP, AP>::import_records (Source&& source, record_format format){
+
+    _record_reader<std::remove_reference_t<Source>> in{source, format};
+    std::vector<std::pair<k_t, v_t>> pairs;
+    std::pair<k_t, v_t> x;
+    while (in.record(x.first, x.second)) {
+        pairs.push_back(std::move(x));
+    }
+    assign(std::make_move_iterator(pairs.begin()), std::make_move_iterator(pairs.end()));
+}
+
+
+// definition of function balance - out of the class
+
+/** function to balance the tree in place (Day-Stout-Warren algorithm)
+ * the tree is turned into a vine with right rotations, then compressed with left rotations:
+ * first the nodes exceeding a complete tree, then half of the spine until a single node is left
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+void bst<k_t, v_t, OP, BP, AP>:: balance() noexcept{
+
+    std::size_t size = make_vine();
+
+    // number of nodes of the largest complete tree with at most size nodes
+    std::size_t complete = 1;
+    while (complete <= size) {
+        complete = 2 * complete + 1;
+    }
+    complete /= 2;
+
+    compress(size - complete);                   // leaves of the last, incomplete level
+    while (complete > 1) {
+        complete /= 2;
+        compress(complete);
+    }
+
+    _update_all();
+}
+
+
+
 
-                auto tmp = swap_node->_right.release();
-                starting_node->_right.reset(tmp);
-                
+
+// definition of function _join - out of the class
+
+/** private function _join
+ * with heights: the spine of the taller tree (the right one of l, the left one of r) is descended
+ * to the first subtree not taller than the other tree plus one, which becomes a child of m, and m takes its place
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+typename bst<k_t, v_t, OP, BP, AP>::node_ptr bst<k_t, v_t, OP, BP, AP>::_join (node_ptr l, node_ptr m, node_ptr r) noexcept{
+
+    node* mid = m.get();
+    static_cast<typename BP::meta&>(*mid) = typename BP::meta{};      // a new node
+
+    auto link = [mid](node_ptr left, node_ptr right) noexcept {
+        mid->_left = std::move(left);
+        mid->_right = std::move(right);
+        for (node* child : {mid->_left.get(), mid->_right.get()}) {
+            if (child) {
+                child->_parent = mid;
+            }
+        }
+        BP::update(mid);
+    };
+
+    if constexpr (_stores_height<typename BP::meta>::value) {
+        auto height = [](const node* n) noexcept {return n ? n->_height : 0;};
+        int hl = height(l.get());
+        int hr = height(r.get());
+        if (hl > hr + 1 || hr > hl + 1) {
+            bool left_taller = hl > hr;
+            node_ptr& tall = left_taller ? l : r;
+            int target = std::min(hl, hr) + 1;
+            node* parent = tall.get();
+            node_ptr* slot = left_taller ? &parent->_right : &parent->_left;
+            while (height(slot->get()) > target) {
+                parent = slot->get();
+                slot = left_taller ? &parent->_right : &parent->_left;
+            }
+            node_ptr below = std::move(*slot);
+            if (left_taller) {
+                link(std::move(below), std::move(r));
+            }
+            else {
+                link(std::move(l), std::move(below));
+            }
+            mid->_parent = parent;
+            *slot = std::move(m);
+            _retrace<BP>(tall, parent);                // as after an insertion below parent
+            return std::move(tall);
+        }
+    }
+    link(std::move(l), std::move(r));
+    mid->_parent = nullptr;
+    return m;
+}
+
+
+// definition of function _take_nodes - out of the class
+
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+void bst<k_t, v_t, OP, BP, AP>::_take_nodes (bst& x){
+
+    if (_pool.same(x._pool) || _pool.adopt(x._pool)) {
+        return;
+    }
+    bst copy;
+    copy._pool.share(_pool);
+    copy.head = copy._copy(x.head.get());
+    copy._size = x._size;
+    copy._refresh_bounds();
+    comp.allocated(copy._size);
+    x = std::move(copy);                          // x now shares the pool of this tree
+}
+
+
+// definition of function merge - out of the class
+
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+void bst<k_t, v_t, OP, BP, AP>::merge (bst&& x){
+
+    if (&x == this || !x.head) {
+        return;
+    }
+    if (!head || comp(_rightmost->_pair.first, x._leftmost->_pair.first) ||
+        comp(x._rightmost->_pair.first, _leftmost->_pair.first)) {
+        join(std::move(x));                             // disjoint ranges of keys
+        return;
+    }
+    _take_nodes(x);
+
+    auto n = static_cast<double>(_size);
+    auto m = static_cast<double>(x._size);
+    if (m * std::log2(n + 2) < n + m) {
+        // few nodes: each one is attached where a descent of this tree stops, as by insert
+        x.make_vine();
+        while (x.head) {
+            node_ptr next = std::move(x.head);
+            x.head = std::move(next->_right);
+            if (x.head) {
+                x.head->_parent = nullptr;
+            }
+            static_cast<typename BP::meta&>(*next) = typename BP::meta{};     // a new leaf
+            auto pos = _locate(next->_pair.first);
+            if (!pos.found) {
+                _attach(pos, std::move(next));
+            }                                                              // else next is destroyed here
+        }
+    }
+    else {
+        // the two trees are walked together in order, then their nodes are relinked in balanced shape
+        // as by balance(threads); the vector is filled before any link changes
+        std::vector<node*> nodes;
+        std::vector<node*> duplicates;                   // nodes of x with a key of this tree
+        nodes.reserve(_size + x._size);
+        iterator a{_leftmost};
+        iterator b{x._leftmost};
+        while (a.current_ptr() && b.current_ptr()) {
+            if (comp(*a, *b)) {
+                nodes.push_back(a.current_ptr());
+                ++a;
+            }
+            else if (comp(*b, *a)) {
+                nodes.push_back(b.current_ptr());
+                ++b;
             }
-           
+            else {
+                duplicates.push_back(b.current_ptr());
+                ++b;
+            }
+        }
+        for (; a.current_ptr(); ++a) {
+            nodes.push_back(a.current_ptr());
+        }
+        for (; b.current_ptr(); ++b) {
+            nodes.push_back(b.current_ptr());
+        }
+
+        auto relink = [&nodes](std::size_t i) noexcept {
+            node* n = nodes[i];
+            n->_left.release();                  // the children are relinked by their own calls
+            n->_right.release();
+            return node_ptr{n};
+        };
+        node_ptr root = _build_from(0, nodes.size(), relink);
+        root->_parent = nullptr;
+        head.release();                          // the old roots have already been relinked (or are duplicates)
+        x.head.release();
+        head = std::move(root);
+        for (node* d : duplicates) {
+            d->_left.release();
+            d->_right.release();
+            node_ptr{d}.reset();
         }
-        
+        _size = nodes.size();
+        _refresh_bounds();
+    }
+    x._size = 0;
+    x._leftmost = x._rightmost = nullptr;
+}
+
+
+// definition of function split - out of the class
+
+/** function split
+ * the last node of the search path is found first; then the path is climbed through the parent pointers:
+ * every node, with its subtree away from the path, is joined to the tree of the smaller keys or to the tree
+ * of the others, built from the bottom (the joins cost O(log n) altogether with heights)
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+bst<k_t, v_t, OP, BP, AP> bst<k_t, v_t, OP, BP, AP>::split (const k_t& x){
+
+    bst right;
+    right.comp.op = comp.op;
+    right._auto.threshold = _auto.threshold;
+    if (!head) {
+        return right;
+    }
+    right._pool.share(_pool);
+
+    node* p = head.get();
+    for (;;) {
+        node* next = comp(p->_pair.first, x) ? p->_right.get() : p->_left.get();
+        if (!next) {
+            break;
+        }
+        p = next;
+    }
+
+    std::size_t total = _size;
+    node_ptr l;
+    node_ptr r;
+    while (p) {
+        node* parent = p->_parent;
+        node_ptr owner = parent ? std::move(_child_slot(head, p)) : std::move(head);
+        if (comp(p->_pair.first, x)) {                   // p and its left subtree have smaller keys
+            node_ptr sub = std::move(p->_left);
+            if (sub) {
+                sub->_parent = nullptr;
+            }
+            l = _join(std::move(sub), std::move(owner), std::move(l));
+        }
+        else {                                           // p and its right subtree have keys not less than x
+            node_ptr sub = std::move(p->_right);
+            if (sub) {
+                sub->_parent = nullptr;
+            }
+            r = _join(std::move(r), std::move(owner), std::move(sub));
+        }
+        p = parent;
+    }
+    head = std::move(l);
+    right.head = std::move(r);
+    _refresh_bounds();
+    right._refresh_bounds();
+
+    if constexpr (_stores_count<node>::value) {
+        _size = _subtree_count(head.get());
+    }
+    else {
+        // the two trees are walked together until the smaller one ends
+        std::size_t smaller = 0;
+        iterator a{_leftmost};
+        iterator b{right._leftmost};
+        while (a.current_ptr() && b.current_ptr()) {
+            ++a;
+            ++b;
+            ++smaller;
+        }
+        _size = a.current_ptr() ? total - smaller : smaller;
+    }
+    right._size = total - _size;
+    return right;
+}
+
+
+// definition of function join - out of the class
+
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+void bst<k_t, v_t, OP, BP, AP>::join (bst&& x){
+
+    if (&x == this || !x.head) {
+        return;
+    }
+    bool after = !head || comp(_rightmost->_pair.first, x._leftmost->_pair.first);
+    if (!after && !comp(x._rightmost->_pair.first, _leftmost->_pair.first)) {
+        merge(std::move(x));                            // the keys overlap
+        return;
+    }
+    _take_nodes(x);
+
+    node* first = x._leftmost;
+    node* last = x._rightmost;
+    if (after) {
+        node_ptr m = x._unlink(first);
+        head = _join(std::move(head), std::move(m), std::move(x.head));
+        _leftmost = _leftmost ? _leftmost : first;
+        _rightmost = last;
+    }
+    else {
+        node_ptr m = x._unlink(last);
+        head = _join(std::move(x.head), std::move(m), std::move(head));
+        _leftmost = first;
+    }
+    _size += x._size + 1;
+    x._size = 0;
+    x._leftmost = x._rightmost = nullptr;
+}
+
+
+// definition of function _combine - out of the class
+
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+bst<k_t, v_t, OP, BP, AP> bst<k_t, v_t, OP, BP, AP>::_combine (const bst& x, bool only_this, bool only_x, bool both) const{
+
+    std::vector<const node*> picked;
+    picked.reserve((only_this || both ? _size : 0) + (only_x ? x._size : 0));
+    auto a = begin();
+    auto b = x.begin();
+    while (a != end() && b != x.end()) {
+        if (comp(*a, *b)) {
+            if (only_this) {
+                picked.push_back(a.current_ptr());
+            }
+            ++a;
+        }
+        else if (comp(*b, *a)) {
+            if (only_x) {
+                picked.push_back(b.current_ptr());
+            }
+            ++b;
+        }
+        else {
+            if (both) {
+                picked.push_back(a.current_ptr());
+            }
+            ++a;
+            ++b;
+        }
+    }
+    for (; only_this && a != end(); ++a) {
+        picked.push_back(a.current_ptr());
+    }
+    for (; only_x && b != x.end(); ++b) {
+        picked.push_back(b.current_ptr());
     }
 
-    else{
+    bst result;
+    result.comp.op = comp.op;
+    result._pool.reserve(picked.size());
+    auto make = [&result, &picked](std::size_t i) {return result._make_node(picked[i]->_pair);};
+    result.head = result._build_from(0, picked.size(), make);
+    result._size = picked.size();
+    result.comp.allocated(result._size);
+    result._refresh_bounds();
+    return result;
+}
+
+
+// definition of function _unlink - out of class bst
+
+/** private function _unlink
+ * detaches the node n from the tree, relinking its successor in its place if it has two children
+ * @return returns the unique pointer owning n
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+typename bst<k_t, v_t, OP, BP, AP>::node_ptr bst<k_t, v_t, OP, BP, AP> :: _unlink(node* n) noexcept {
+
+    node* rebalance_from;            // lowest node whose subtree has changed
+    node_ptr replacement;            // node taking the place of n (may be nullptr)
+
+    // the first (last) node has no left (right) child: the next one in order is either
+    // the left most node of its right subtree or its parent
+    if (n == _leftmost) {
+        if (n->_right) {
+            _leftmost = n->_right.get();
+            while (_leftmost->_left) {
+                _leftmost = _leftmost->_left.get();
+            }
+        }
+        else {
+            _leftmost = n->_parent;
+        }
+    }
+    if (n == _rightmost) {
+        if (n->_left) {
+            _rightmost = n->_left.get();
+            while (_rightmost->_right) {
+                _rightmost = _rightmost->_right.get();
+            }
+        }
+        else {
+            _rightmost = n->_parent;
+        }
+    }
+
+    // 1 and 2: n has at most one child --> the child takes its place
+    if (!n->_left || !n->_right) {
+        replacement = n->_left ? std::move(n->_left) : std::move(n->_right);
+        rebalance_from = n->_parent;
+    }
+    // 3: n has two children --> its successor (left most node of the right subtree) takes its place
+    else {
+        node* succ = n->_right.get();
+        while (succ->_left) {
+            succ = succ->_left.get();
+        }
+
+        if (succ->_parent == n) {                        // the successor is the right child of n
+            replacement = std::move(n->_right);          // and keeps its own right subtree
+            rebalance_from = succ;
+        }
+        else {                                           // the right subtree of the successor
+            node* succ_parent = succ->_parent;           // is attached to the parent of the successor
+            replacement = std::move(succ_parent->_left);
+            succ_parent->_left = std::move(succ->_right);
+            if (succ_parent->_left) {
+                succ_parent->_left->_parent = succ_parent;
+            }
+            succ->_right = std::move(n->_right);
+            succ->_right->_parent = succ;
+            rebalance_from = succ_parent;
+        }
+        succ->_left = std::move(n->_left);
+        succ->_left->_parent = succ;
+        static_cast<typename BP::meta&>(*succ) = static_cast<typename BP::meta&>(*n);   // same position, same data
+    }
+
+    if (replacement) {
+        replacement->_parent = n->_parent;
+    }
+    auto& slot = _child_slot(head, n);
+    node_ptr owner = std::move(slot);
+    slot = std::move(replacement);
+    n->_parent = nullptr;
+
+    _rebalance(rebalance_from);
+    --_size;
+    return owner;
+}
+
+
+
+
+// definition of function _depths - out of the class
+
+/** private function _depths
+ * pre-order walk: down to the left child, else to the right one; from a leaf up to the first
+ * ancestor reached from its left child that has a right child, then to that right child
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+template<typename F>
+void bst<k_t, v_t, OP, BP, AP>::_depths (F&& f) const noexcept{
+
+    const node* x = head.get();
+    std::size_t depth = 0;
+    while (x) {
+        f(depth);
+        if (x->_left) {
+            x = x->_left.get();
+            ++depth;
+        }
+        else if (x->_right) {
+            x = x->_right.get();
+            ++depth;
+        }
+        else {
+            const node* p = x->_parent;
+            while (p && (p->_right.get() == x || !p->_right)) {
+                x = p;
+                p = p->_parent;
+                --depth;
+            }
+            x = p ? p->_right.get() : nullptr;       // sibling of x: same depth
+        }
+    }
+}
+
+
+// definition of function height - out of the class
+
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+std::size_t bst<k_t, v_t, OP, BP, AP>::height () const noexcept{
+
+    if constexpr (_stores_height<typename BP::meta>::value) {
+        return head ? static_cast<std::size_t>(head->_height) : 0;
+    }
+    else {
+        std::size_t levels = 0;
+        _depths([&levels](std::size_t d) {levels = std::max(levels, d + 1);});
+        return levels;
+    }
+}
+
+
+// definition of function depth_histogram - out of the class
+
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+std::vector<std::size_t> bst<k_t, v_t, OP, BP, AP>::depth_histogram () const{
+
+    std::vector<std::size_t> histogram;
+    _depths([&histogram](std::size_t d) {
+        if (d == histogram.size()) {                  // pre-order: the depth grows one level at a time
+            histogram.push_back(0);
+        }
+        ++histogram[d];
+    });
+    return histogram;
+}
+
+
+// definition of function stats - out of the class
+
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+bst_stats bst<k_t, v_t, OP, BP, AP>::stats () const{
+
+    bst_stats s;
+    s.size = _size;
+    s.depth_histogram = depth_histogram();
+    s.height = s.depth_histogram.size();
+    double sum = 0;
+    for (std::size_t d = 0; d < s.depth_histogram.size(); ++d) {
+        sum += static_cast<double>(d) * static_cast<double>(s.depth_histogram[d]);
+    }
+    s.average_depth = _size ? sum / static_cast<double>(_size) : 0.0;
+
+    if (const _op_counters* c = comp.counters()) {
+        auto at = [](_counted_op o) {return static_cast<std::size_t>(o);};
+        s.finds = c->calls[at(_counted_op::find)];
+        s.find_comparisons = c->op_comparisons[at(_counted_op::find)];
+        s.inserts = c->calls[at(_counted_op::insert)];
+        s.insert_comparisons = c->op_comparisons[at(_counted_op::insert)];
+        s.erases = c->calls[at(_counted_op::erase)];
+        s.erase_comparisons = c->op_comparisons[at(_counted_op::erase)];
+        s.comparisons = c->comparisons;
+        s.allocations = c->allocations;
+    }
+    s.auto_balances = _auto.balances;
+    return s;
+}
+
+
+// definition of function erase - out of class bst
+
+/** function erase  
+* removes the element (if one exists) with the key equivalent to key.
+* @param x l-value reference of the key of the node to be deleted */
+
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>   
+void bst<k_t, v_t, OP, BP, AP> :: erase(const k_t& x) {
+    
+    if(!_erase(x)){                          // if the key is not present in the bst
         std::cerr << "ERROR: there is no node with key = " << x << std::endl;
     }
 }
 
-#endif
\ No newline at end of file
+
+// definition of function balance - parallel - out of the class
+
+/** function balance - parallel
+ * the pointers to the nodes are collected in order (one vector per piece of _split),
+ * then the nodes are relinked by _build_parallel: every node is taken back from its old links
+ * when it is relinked, and the tree changes owner only at the end, when nothing can throw any more
+ */
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+void bst<k_t, v_t, OP, BP, AP>:: balance(std::size_t threads){
+
+    if (threads < 2 || _size < _parallel_cutoff) {
+        balance();
+        return;
+    }
+
+    std::vector<_piece> pieces;
+    _split(head.get(), _split_levels(threads), pieces);
+    std::vector<std::vector<node*>> parts(pieces.size());
+    _parallel_for(threads, pieces.size(), [&](std::size_t i) {
+        auto collect = [&part = parts[i]](node* n) {part.push_back(n);};
+        if (pieces[i].subtree) {
+            _visit(pieces[i].root, collect);
+        }
+        else {
+            collect(pieces[i].root);
+        }
+    });
+    std::vector<node*> nodes;
+    nodes.reserve(_size);
+    for (auto& part : parts) {
+        nodes.insert(nodes.end(), part.begin(), part.end());
+    }
+
+    auto relink = [&nodes](std::size_t i) noexcept {
+        node* x = nodes[i];
+        x->_left.release();                      // the children are relinked by their own tasks
+        x->_right.release();
+        return node_ptr{x};
+    };
+    node_ptr root = _build_parallel(nodes.size(), relink, threads);
+    head.release();                              // the old root has already been relinked
+    head = std::move(root);
+    _refresh_bounds();
+}
+
+#endif
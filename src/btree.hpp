@@ -0,0 +1,823 @@
+#ifndef _bst_btree
+#define _bst_btree
+#include "traits.hpp"
+#include "simd.hpp"
+
+#include <iostream>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <functional>  //std::less
+#include <type_traits>
+
+/**
+ * ********* B+tree nodes *********
+ *
+ * a leaf stores up to L sorted keys with their values in two parallel arrays,
+ * and it is linked to the previous and next leaf, so that the iteration never goes up the tree
+ * an inner node stores up to I separator keys and I + 1 children:
+ * the keys of child i are not smaller than _keys[i-1] and smaller than _keys[i]
+ * the children are leaves or inner nodes, depending on the level (the tree knows its height)
+ * the arrays are default constructed: k_t and v_t must be default constructible and move assignable
+ */
+template<typename k_t, typename v_t, std::size_t L>
+struct _bleaf {
+
+    using key_type = k_t;
+    using mapped_type = v_t;
+
+    /** number of keys in the leaf */
+    std::size_t _count{0};
+    k_t _keys[L];
+    v_t _values[L];
+    _bleaf* _prev{nullptr};
+    _bleaf* _next{nullptr};
+};
+
+template<typename k_t, std::size_t I>
+struct _binner {
+
+    /** number of keys in the node: the children are _count + 1 */
+    std::size_t _count{0};
+    k_t _keys[I];
+    void* _children[I + 1];
+};
+
+
+/**
+ * *********  Class btree iterator  **********
+ *
+ * bidirectional iterator over the keys of a btree, in order
+ * every instance is a leaf and a position in it, plus a pointer to the member
+ * of the tree holding its last leaf, so that end() can be decremented
+ * (the elements move when other keys are inserted or erased: both invalidate the iterators)
+ *
+ * @param O --> template for the iterator (key type, const or not)
+ * @param L --> template for the leaf type of the tree
+ */
+template<typename O, typename L>
+class _btree_iterator{
+
+    using leaf = L;
+    using v_t = typename leaf::mapped_type;
+    leaf* current{nullptr};           //leaf of the element, nullptr for end()
+    std::size_t index{0};             //position of the element in the leaf
+    leaf* const* last{nullptr};       //raw pointer to the last leaf of the tree, used by --end()
+
+ public:
+    using value_type = O;
+    using reference = value_type &;
+    using pointer = value_type *;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    /** default ctor */
+    _btree_iterator() noexcept = default;
+
+    /** custom ctor: the element at position i of leaf x */
+    _btree_iterator(leaf* x, std::size_t i, leaf* const* last_leaf = nullptr) noexcept :
+        current{x}, index{i}, last{last_leaf} {}
+
+    /** pre-increment operator: next position, or first position of the next leaf */
+    _btree_iterator& operator++() noexcept {
+        if (++index == current->_count) {
+            current = current->_next;
+            index = 0;
+        }
+        return *this;
+    }
+
+    /** post-increment operator */
+    _btree_iterator operator++(int) noexcept {
+        auto tmp{*this};
+        ++(*this);
+        return tmp;
+    }
+
+    /** pre-decrement operator: decrementing end() gives the last element */
+    _btree_iterator& operator--() noexcept {
+        if (!current) {
+            current = *last;
+            index = current->_count;
+        }
+        else if (index == 0) {
+            current = current->_prev;
+            index = current->_count;
+        }
+        --index;
+        return *this;
+    }
+
+    /** post-decrement operator */
+    _btree_iterator operator--(int) noexcept {
+        auto tmp{*this};
+        --(*this);
+        return tmp;
+    }
+
+    /** arrow operator-> */
+    pointer operator->() const noexcept {return &**this;}
+
+    /** dereference operator*: returns the key of the element */
+    reference operator*() const noexcept {return current->_keys[index];}
+
+    /** function value: returns the associated value of the element */
+    v_t& value() {return current->_values[index];}
+
+    /** function value - const */
+    const v_t& value() const {return current->_values[index];}
+
+    /** operator == */
+    friend
+    bool operator==(const _btree_iterator& a, const _btree_iterator& b) noexcept {
+        return a.current == b.current && a.index == b.index;
+    }
+
+    /** operator != */
+    friend
+    bool operator!=(const _btree_iterator& a, const _btree_iterator& b) noexcept {return !(a == b);}
+};
+
+
+/**
+ * ********* Class btree **********
+ *
+ * alternative backend with the interface of bst: a B+tree storing many sorted keys per node,
+ * so that a lookup touches a few contiguous blocks of memory instead of one node per level
+ * all the elements are in the leaves, the inner nodes only route the searches
+ * the nodes have about NodeBytes bytes (a few cache lines), the number of keys per node follows
+ * every node but the root is at least half full: the height is O(log n / log(NodeBytes / sizeof(k_t)))
+ *
+ * @param k_t       --> template for key type
+ * @param v_t       --> template for value type
+ * @param OP        --> template for Operator Comparison (OP) which is std::less<k_t>
+ * @param NodeBytes --> approximate size of a node in bytes
+ */
+template <typename k_t, typename v_t, typename OP = std::less<k_t>, std::size_t NodeBytes = 256>
+class btree{
+
+ public:
+    /** number of elements of a leaf */
+    static constexpr std::size_t leaf_capacity =
+        std::max<std::size_t>(4, (NodeBytes - 3 * sizeof(void*)) / (sizeof(k_t) + sizeof(v_t)));
+    /** number of keys of an inner node */
+    static constexpr std::size_t inner_capacity =
+        std::max<std::size_t>(4, (NodeBytes - 2 * sizeof(void*)) / (sizeof(k_t) + sizeof(void*)));
+
+ private:
+    using leaf = _bleaf<k_t, v_t, leaf_capacity>;
+    using inner = _binner<k_t, inner_capacity>;
+    using iterator = _btree_iterator<k_t, leaf>;
+    using const_iterator = _btree_iterator<const k_t, leaf>;
+
+    /** minimum number of elements of a leaf and of keys of an inner node (but the root) */
+    static constexpr std::size_t _min_leaf = leaf_capacity / 2;
+    static constexpr std::size_t _min_inner = (inner_capacity - 1) / 2;
+    /** bound on the height: every inner node but the root has at least two children */
+    static constexpr int _max_height = 64;
+
+    /** private members of the class */
+    void* _root{nullptr};            //a leaf if _height == 1
+    int _height{0};                  //number of levels (0 if empty)
+    OP comp;                         //comparison
+    std::size_t _size{0};            //number of elements
+    leaf* _first{nullptr};           //leaf with the smallest keys
+    leaf* _last{nullptr};            //leaf with the largest keys
+
+    /** a step of a descent: an inner node and the child that has been followed */
+    struct _step {
+        inner* node;
+        std::size_t child;
+    };
+
+    /** true if the keys of a node are searched with the SIMD kernels (see simd.hpp) */
+    template<typename K>
+    static constexpr bool _simd = _simd_searchable<k_t, OP>::value && std::is_same_v<K, k_t>;
+
+    /** private function _lower_index
+     * @return returns the position of the first key of n which is not smaller than x */
+    template<typename N, typename K>
+    std::size_t _lower_index(const N* n, const K& x) const noexcept {
+        if constexpr (_simd<K>) {
+            return simd_lower_bound(n->_keys, n->_count, x);
+        }
+        else {
+            return static_cast<std::size_t>(std::lower_bound(n->_keys, n->_keys + n->_count, x, comp) - n->_keys);
+        }
+    }
+
+    /** private function _upper_index
+     * @return returns the position of the first key of n which is greater than x */
+    template<typename N, typename K>
+    std::size_t _upper_index(const N* n, const K& x) const noexcept {
+        if constexpr (_simd<K>) {
+            return simd_upper_bound(n->_keys, n->_count, x);
+        }
+        else {
+            return static_cast<std::size_t>(std::upper_bound(n->_keys, n->_keys + n->_count, x, comp) - n->_keys);
+        }
+    }
+
+    /** private function _child_index
+     * @return returns the child of n whose keys may be equal to x (first separator greater than x) */
+    template<typename K>
+    std::size_t _child_index(const inner* n, const K& x) const noexcept {
+        if constexpr (_simd<K>) {
+            return simd_upper_bound(n->_keys, n->_count, x);
+        }
+        else {
+            return static_cast<std::size_t>(std::upper_bound(n->_keys, n->_keys + n->_count, x, comp) - n->_keys);
+        }
+    }
+
+    /** private function _leaf_of
+     * descends from the root to the leaf which would contain x, the tree must not be empty
+     * @param path if not nullptr, receives the steps of the descent (_height - 1 of them) */
+    template<typename K>
+    leaf* _leaf_of(const K& x, _step* path = nullptr) const noexcept {
+        void* n = _root;
+        for (int h = _height; h > 1; --h) {
+            auto in = static_cast<inner*>(n);
+            std::size_t i = _child_index(in, x);
+            if (path) {
+                *path++ = _step{in, i};
+            }
+            n = in->_children[i];
+        }
+        return static_cast<leaf*>(n);
+    }
+
+    /** private function _find
+     * @return returns the iterator (of type I) to the element with key x, end() if there is none */
+    template<typename I, typename K>
+    I _find(const K& x) const noexcept {
+        if (!_root) {
+            return I{nullptr, 0, &_last};
+        }
+        leaf* l = _leaf_of(x);
+        std::size_t i = _lower_index(l, x);
+        if (i < l->_count && !comp(x, l->_keys[i])) {
+            return I{l, i, &_last};
+        }
+        return I{nullptr, 0, &_last};
+    }
+
+    /** private function _lower
+     * @return returns the iterator (of type I) to the first element not smaller than x */
+    template<typename I, typename K>
+    I _lower(const K& x) const noexcept {
+        if (!_root) {
+            return I{nullptr, 0, &_last};
+        }
+        leaf* l = _leaf_of(x);
+        std::size_t i = _lower_index(l, x);
+        if (i == l->_count) {                      // all the keys of l are smaller: first of the next leaf
+            return I{l->_next, 0, &_last};
+        }
+        return I{l, i, &_last};
+    }
+
+    /** private function _upper
+     * @return returns the iterator (of type I) to the first element greater than x */
+    template<typename I, typename K>
+    I _upper(const K& x) const noexcept {
+        if (!_root) {
+            return I{nullptr, 0, &_last};
+        }
+        leaf* l = _leaf_of(x);
+        std::size_t i = _upper_index(l, x);
+        if (i == l->_count) {                      // all the keys of l are not greater: first of the next leaf
+            return I{l->_next, 0, &_last};
+        }
+        return I{l, i, &_last};
+    }
+
+    /** private function _insert_at
+     * puts key and value at position i of a leaf which is not full */
+    static void _insert_at(leaf* l, std::size_t i, k_t& key, v_t& value) {
+        std::move_backward(l->_keys + i, l->_keys + l->_count, l->_keys + l->_count + 1);
+        std::move_backward(l->_values + i, l->_values + l->_count, l->_values + l->_count + 1);
+        l->_keys[i] = std::move(key);
+        l->_values[i] = std::move(value);
+        ++l->_count;
+    }
+
+    /** private function _insert_child
+     * puts the separator key at position i and the child at position i + 1 of an inner node which is not full */
+    static void _insert_child(inner* n, std::size_t i, k_t& key, void* child) {
+        std::move_backward(n->_keys + i, n->_keys + n->_count, n->_keys + n->_count + 1);
+        std::move_backward(n->_children + i + 1, n->_children + n->_count + 1, n->_children + n->_count + 2);
+        n->_keys[i] = std::move(key);
+        n->_children[i + 1] = child;
+        ++n->_count;
+    }
+
+    /** private function _remove_child
+     * removes the separator key at position i and the child at position i + 1 of an inner node */
+    static void _remove_child(inner* n, std::size_t i) {
+        std::move(n->_keys + i + 1, n->_keys + n->_count, n->_keys + i);
+        std::move(n->_children + i + 2, n->_children + n->_count + 1, n->_children + i + 1);
+        --n->_count;
+    }
+
+    /** private function _merge_leaves
+     * moves the elements of b (the next leaf) at the end of a and deletes b */
+    void _merge_leaves(leaf* a, leaf* b) {
+        std::move(b->_keys, b->_keys + b->_count, a->_keys + a->_count);
+        std::move(b->_values, b->_values + b->_count, a->_values + a->_count);
+        a->_count += b->_count;
+        a->_next = b->_next;
+        if (a->_next) {
+            a->_next->_prev = a;
+        }
+        else {
+            _last = a;
+        }
+        delete b;
+    }
+
+    /** private function _merge_inners
+     * moves the separator and the keys and children of b (the next sibling) at the end of a and deletes b */
+    static void _merge_inners(inner* a, inner* b, k_t& separator) {
+        a->_keys[a->_count] = std::move(separator);
+        std::move(b->_keys, b->_keys + b->_count, a->_keys + a->_count + 1);
+        std::copy(b->_children, b->_children + b->_count + 1, a->_children + a->_count + 1);
+        a->_count += b->_count + 1;
+        delete b;
+    }
+
+    template<typename K>
+    bool _erase(const K& x);
+
+    void* _copy(const void* n, int h, leaf*& prev) const;
+
+    /** private function _destroy
+     * deletes the subtree rooted at n, of height h */
+    static void _destroy(void* n, int h) noexcept {
+        if (h == 1) {
+            delete static_cast<leaf*>(n);
+            return;
+        }
+        auto in = static_cast<inner*>(n);
+        for (std::size_t c = 0; c <= in->_count; ++c) {
+            _destroy(in->_children[c], h - 1);
+        }
+        delete in;
+    }
+
+ public:
+
+    /** default ctor */
+    btree() noexcept = default;
+
+    /** default dtor */
+    ~btree() noexcept {clear();}
+
+    /** move ctor */
+    btree(btree&& x) noexcept :
+        _root{std::exchange(x._root, nullptr)}, _height{std::exchange(x._height, 0)}, comp{std::move(x.comp)},
+        _size{std::exchange(x._size, 0)}, _first{std::exchange(x._first, nullptr)}, _last{std::exchange(x._last, nullptr)} {}
+
+    /** move assignment */
+    btree& operator=(btree&& x) noexcept {
+        if (this != &x) {
+            clear();
+            _root = std::exchange(x._root, nullptr);
+            _height = std::exchange(x._height, 0);
+            comp = std::move(x.comp);
+            _size = std::exchange(x._size, 0);
+            _first = std::exchange(x._first, nullptr);
+            _last = std::exchange(x._last, nullptr);
+        }
+        return *this;
+    }
+
+    /** copy ctor - deep copy, node by node (same shape as x) */
+    btree(const btree& x) : comp{x.comp} {
+        if (x._root) {
+            leaf* prev = nullptr;
+            _root = x._copy(x._root, x._height, prev);
+            _height = x._height;
+            _size = x._size;
+            void* n = _root;
+            for (int h = _height; h > 1; --h) {     // the first leaf is the leftmost one
+                n = static_cast<inner*>(n)->_children[0];
+            }
+            _first = static_cast<leaf*>(n);
+            _last = prev;                           // the last leaf copied
+        }
+    }
+
+    /** copy assignment */
+    btree& operator=(const btree& x) {
+        auto tmp{x};
+        *this = std::move(tmp);
+        return *this;
+    }
+
+    /** function insert
+     * inserts a new node if the key is not present
+     * @return a pair of an iterator (pointing to the element with that key) and a bool (true if inserted) */
+    std::pair<iterator,bool> insert(const std::pair<k_t, v_t>& x) {return try_emplace(x.first, x.second);}
+
+    /** function insert - r-value */
+    std::pair<iterator,bool> insert(std::pair<k_t, v_t>&& x) {return try_emplace(std::move(x.first), std::move(x.second));}
+
+    /** function emplace
+     * @return a pair of an iterator and a bool (true if inserted), as insert */
+    template<class... Types>
+    std::pair<iterator,bool> emplace(Types&&... args) {
+        return insert(std::pair<k_t, v_t>{std::forward<Types>(args)...});
+    }
+
+    /** function try_emplace
+     * if there is no element with key x, inserts it with a value constructed from args
+     * the tree is descended once; full nodes are split on the way back up
+     * @return a pair of an iterator (pointing to the element with key x) and a bool (true if inserted) */
+    template <typename K, typename... Types >
+    std::pair<iterator,bool> try_emplace(K&& x, Types&&... args);
+
+    /** function find
+     * @return returns an iterator to the key or end() */
+    iterator find(const k_t& x) noexcept {return _find<iterator>(x);}
+
+    /** function find - const */
+    const_iterator find(const k_t& x) const noexcept {return _find<const_iterator>(x);}
+
+    /** function find - heterogeneous (only if OP is transparent) */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    iterator find(const K& x) noexcept {return _find<iterator>(x);}
+
+    /** function find - heterogeneous, const */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    const_iterator find(const K& x) const noexcept {return _find<const_iterator>(x);}
+
+    /** function contains
+     * @return returns true if there is an element with key x */
+    bool contains(const k_t& x) const noexcept {return _find<const_iterator>(x) != end();}
+
+    /** function contains - heterogeneous (only if OP is transparent) */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    bool contains(const K& x) const noexcept {return _find<const_iterator>(x) != end();}
+
+    /** function lower_bound
+     * @return returns an iterator to the first key not smaller than x, or end() */
+    iterator lower_bound(const k_t& x) noexcept {return _lower<iterator>(x);}
+
+    /** function lower_bound - const */
+    const_iterator lower_bound(const k_t& x) const noexcept {return _lower<const_iterator>(x);}
+
+    /** function upper_bound
+     * @return returns an iterator to the first key greater than x, or end() */
+    iterator upper_bound(const k_t& x) noexcept {return _upper<iterator>(x);}
+
+    /** function upper_bound - const */
+    const_iterator upper_bound(const k_t& x) const noexcept {return _upper<const_iterator>(x);}
+
+    /** function equal_range
+     * @return returns the pair lower_bound(x), upper_bound(x): the element with key x, if any */
+    std::pair<iterator, iterator> equal_range(const k_t& x) noexcept {
+        auto first = _lower<iterator>(x);
+        if (first != end() && !comp(x, *first)) {
+            return {first, std::next(first)};
+        }
+        return {first, first};
+    }
+
+    /** function equal_range - const */
+    std::pair<const_iterator, const_iterator> equal_range(const k_t& x) const noexcept {
+        auto first = _lower<const_iterator>(x);
+        if (first != end() && !comp(x, *first)) {
+            return {first, std::next(first)};
+        }
+        return {first, first};
+    }
+
+    /** function erase
+     * removes the element with key x; merges or refills the nodes left less than half full
+     * @param x l-value reference of the key of the element to be deleted */
+    void erase(const k_t& x) {
+        if (!_erase(x)) {
+            std::cerr << "ERROR: there is no node with key = " << x << std::endl;
+        }
+    }
+
+    /** function clear: deletes all the nodes */
+    void clear() noexcept {
+        if (_root) {
+            _destroy(_root, _height);
+        }
+        _root = nullptr;
+        _height = 0;
+        _size = 0;
+        _first = _last = nullptr;
+    }
+
+    /** function size
+     * @return returns the number of elements */
+    std::size_t size() const noexcept {return _size;}
+
+    /** function height
+     * @return returns the number of levels of the tree */
+    int height() const noexcept {return _height;}
+
+    /** function begin */
+    iterator begin() noexcept {return iterator{_first, 0, &_last};}
+    const_iterator begin() const noexcept {return const_iterator{_first, 0, &_last};}
+    const_iterator cbegin() const noexcept {return begin();}
+
+    /** function end */
+    iterator end() noexcept {return iterator{nullptr, 0, &_last};}
+    const_iterator end() const noexcept {return const_iterator{nullptr, 0, &_last};}
+    const_iterator cend() const noexcept {return end();}
+
+    /** subscripting operator
+     * returns a reference to the value mapped to x, inserting it if the key does not exist */
+    v_t& operator[](const k_t& x) {return try_emplace(x).first.value();}
+
+    /** subscripting operator - r-value */
+    v_t& operator[](k_t&& x) {return try_emplace(std::move(x)).first.value();}
+
+    /** put-to operator */
+    friend
+    std::ostream& operator<<(std::ostream& os, const btree& x) {
+        if (!x._size) {
+            os << "WARNING: empty tree";
+            return os;
+        }
+        for (auto& key : x) {
+            os << key << " ";
+        }
+        os << '\n';
+        return os;
+    }
+};
+
+
+// definition of function try_emplace - out of the class
+template<typename k_t, typename v_t, typename OP, std::size_t NodeBytes>
+template<typename K, typename... Types>
+std::pair<typename btree<k_t, v_t, OP, NodeBytes>::iterator, bool>
+btree<k_t, v_t, OP, NodeBytes>::try_emplace(K&& x, Types&&... args) {
+    if constexpr (!_is_transparent<OP>::value && !std::is_same_v<std::decay_t<K>, k_t>) {
+        return try_emplace(k_t(std::forward<K>(x)), std::forward<Types>(args)...);   // build the key once
+    }
+    else {
+        if (!_root) {
+            _root = _first = _last = new leaf;
+            _height = 1;
+        }
+        _step path[_max_height];
+        leaf* l = _leaf_of(x, path);
+        std::size_t i = _lower_index(l, x);
+        if (i < l->_count && !comp(x, l->_keys[i])) {
+            return std::pair<iterator,bool>{iterator{l, i, &_last}, false};
+        }
+
+        k_t key(std::forward<K>(x));
+        v_t value(std::forward<Types>(args)...);
+        if (l->_count < leaf_capacity) {                 // room in the leaf: no split
+            _insert_at(l, i, key, value);
+            ++_size;
+            return std::pair<iterator,bool>{iterator{l, i, &_last}, true};
+        }
+
+        // the new nodes are allocated before touching the tree: one leaf, one node per full inner node
+        // on the path and a new root if they are all full
+        int depth = _height - 1;
+        int splits = 0;
+        while (splits < depth && path[depth - 1 - splits].node->_count == inner_capacity) {
+            ++splits;
+        }
+        leaf* right = new leaf;
+        inner* spare[_max_height + 1];
+        int made = 0;
+        try {
+            for (; made < splits + (splits == depth); ++made) {
+                spare[made] = new inner;
+            }
+        }
+        catch (...) {
+            while (made) {
+                delete spare[--made];
+            }
+            delete right;
+            throw;
+        }
+
+        // split the leaf: the upper half goes to the new leaf on the right
+        std::size_t mid = leaf_capacity / 2;
+        std::move(l->_keys + mid, l->_keys + leaf_capacity, right->_keys);
+        std::move(l->_values + mid, l->_values + leaf_capacity, right->_values);
+        right->_count = leaf_capacity - mid;
+        l->_count = mid;
+        right->_prev = l;
+        right->_next = l->_next;
+        if (right->_next) {
+            right->_next->_prev = right;
+        }
+        else {
+            _last = right;
+        }
+        l->_next = right;
+        iterator it = i <= mid ? iterator{l, i, &_last} : iterator{right, i - mid, &_last};
+        _insert_at(i <= mid ? l : right, i <= mid ? i : i - mid, key, value);
+        ++_size;
+
+        // add the separator and the new node to the parent, splitting the full ones
+        k_t separator = right->_keys[0];
+        void* child = right;
+        int s = 0;
+        while (depth > 0) {
+            auto step = path[--depth];
+            inner* n = step.node;
+            if (n->_count < inner_capacity) {
+                _insert_child(n, step.child, separator, child);
+                return std::pair<iterator,bool>{it, true};
+            }
+            inner* q = spare[s++];                      // the upper half goes to q, the middle key goes up
+            std::size_t m = inner_capacity / 2;
+            k_t up = std::move(n->_keys[m]);
+            std::move(n->_keys + m + 1, n->_keys + inner_capacity, q->_keys);
+            std::copy(n->_children + m + 1, n->_children + inner_capacity + 1, q->_children);
+            q->_count = inner_capacity - m - 1;
+            n->_count = m;
+            if (step.child <= m) {
+                _insert_child(n, step.child, separator, child);
+            }
+            else {
+                _insert_child(q, step.child - m - 1, separator, child);
+            }
+            separator = std::move(up);
+            child = q;
+        }
+
+        inner* root = spare[s];                         // the root has been split: the tree grows by one level
+        root->_keys[0] = std::move(separator);
+        root->_children[0] = _root;
+        root->_children[1] = child;
+        root->_count = 1;
+        _root = root;
+        ++_height;
+        return std::pair<iterator,bool>{it, true};
+    }
+}
+
+
+// definition of function _erase - out of the class
+template<typename k_t, typename v_t, typename OP, std::size_t NodeBytes>
+template<typename K>
+bool btree<k_t, v_t, OP, NodeBytes>::_erase(const K& x) {
+    if (!_root) {
+        return false;
+    }
+    _step path[_max_height];
+    leaf* l = _leaf_of(x, path);
+    std::size_t i = _lower_index(l, x);
+    if (i == l->_count || comp(x, l->_keys[i])) {
+        return false;
+    }
+    std::move(l->_keys + i + 1, l->_keys + l->_count, l->_keys + i);
+    std::move(l->_values + i + 1, l->_values + l->_count, l->_values + i);
+    --l->_count;
+    --_size;
+
+    int depth = _height - 1;
+    if (depth == 0) {                                    // the root is a leaf
+        if (l->_count == 0) {
+            clear();
+        }
+        return true;
+    }
+    if (l->_count >= _min_leaf) {
+        return true;
+    }
+
+    // the leaf is less than half full: take an element from a sibling, or merge with it
+    inner* p = path[depth - 1].node;
+    std::size_t c = path[depth - 1].child;
+    leaf* left = c > 0 ? static_cast<leaf*>(p->_children[c - 1]) : nullptr;
+    leaf* right = c < p->_count ? static_cast<leaf*>(p->_children[c + 1]) : nullptr;
+    if (left && left->_count > _min_leaf) {
+        std::move_backward(l->_keys, l->_keys + l->_count, l->_keys + l->_count + 1);
+        std::move_backward(l->_values, l->_values + l->_count, l->_values + l->_count + 1);
+        --left->_count;
+        l->_keys[0] = std::move(left->_keys[left->_count]);
+        l->_values[0] = std::move(left->_values[left->_count]);
+        ++l->_count;
+        p->_keys[c - 1] = l->_keys[0];
+        return true;
+    }
+    if (right && right->_count > _min_leaf) {
+        l->_keys[l->_count] = std::move(right->_keys[0]);
+        l->_values[l->_count] = std::move(right->_values[0]);
+        ++l->_count;
+        std::move(right->_keys + 1, right->_keys + right->_count, right->_keys);
+        std::move(right->_values + 1, right->_values + right->_count, right->_values);
+        --right->_count;
+        p->_keys[c] = right->_keys[0];
+        return true;
+    }
+    if (left) {
+        _merge_leaves(left, l);
+        _remove_child(p, c - 1);
+    }
+    else {
+        _merge_leaves(l, right);
+        _remove_child(p, c);
+    }
+
+    // the parent has lost a child: go up while the inner nodes are less than half full
+    for (--depth; depth > 0; --depth) {
+        inner* n = path[depth].node;
+        if (n->_count >= _min_inner) {
+            return true;
+        }
+        p = path[depth - 1].node;
+        c = path[depth - 1].child;
+        inner* left = c > 0 ? static_cast<inner*>(p->_children[c - 1]) : nullptr;
+        inner* right = c < p->_count ? static_cast<inner*>(p->_children[c + 1]) : nullptr;
+        if (left && left->_count > _min_inner) {         // the last child of left moves to n
+            std::move_backward(n->_keys, n->_keys + n->_count, n->_keys + n->_count + 1);
+            std::move_backward(n->_children, n->_children + n->_count + 1, n->_children + n->_count + 2);
+            n->_keys[0] = std::move(p->_keys[c - 1]);
+            n->_children[0] = left->_children[left->_count];
+            p->_keys[c - 1] = std::move(left->_keys[left->_count - 1]);
+            --left->_count;
+            ++n->_count;
+            return true;
+        }
+        if (right && right->_count > _min_inner) {       // the first child of right moves to n
+            n->_keys[n->_count] = std::move(p->_keys[c]);
+            n->_children[n->_count + 1] = right->_children[0];
+            ++n->_count;
+            p->_keys[c] = std::move(right->_keys[0]);
+            std::move(right->_keys + 1, right->_keys + right->_count, right->_keys);
+            std::move(right->_children + 1, right->_children + right->_count + 1, right->_children);
+            --right->_count;
+            return true;
+        }
+        if (left) {
+            _merge_inners(left, n, p->_keys[c - 1]);
+            _remove_child(p, c - 1);
+        }
+        else {
+            _merge_inners(n, right, p->_keys[c]);
+            _remove_child(p, c);
+        }
+    }
+
+    auto root = static_cast<inner*>(_root);
+    if (root->_count == 0) {                             // the root has one child left: the tree shrinks by one level
+        _root = root->_children[0];
+        delete root;
+        --_height;
+    }
+    return true;
+}
+
+
+// definition of function _copy - out of the class
+template<typename k_t, typename v_t, typename OP, std::size_t NodeBytes>
+void* btree<k_t, v_t, OP, NodeBytes>::_copy(const void* n, int h, leaf*& prev) const {
+    if (h == 1) {
+        auto src = static_cast<const leaf*>(n);
+        auto l = new leaf;
+        try {
+            std::copy(src->_keys, src->_keys + src->_count, l->_keys);
+            std::copy(src->_values, src->_values + src->_count, l->_values);
+        }
+        catch (...) {
+            delete l;
+            throw;
+        }
+        l->_count = src->_count;
+        l->_prev = prev;                 // the leaves are copied in order
+        if (prev) {
+            prev->_next = l;
+        }
+        prev = l;
+        return l;
+    }
+
+    auto src = static_cast<const inner*>(n);
+    auto in = new inner;
+    std::size_t done = 0;
+    try {
+        std::copy(src->_keys, src->_keys + src->_count, in->_keys);
+        for (; done <= src->_count; ++done) {
+            in->_children[done] = _copy(src->_children[done], h - 1, prev);
+        }
+    }
+    catch (...) {
+        while (done) {
+            _destroy(in->_children[--done], h - 1);
+        }
+        delete in;
+        throw;
+    }
+    in->_count = src->_count;
+    return in;
+}
+
+#endif
@@ -0,0 +1,740 @@
+#ifndef _bst_compact
+#define _bst_compact
+
+#include <iostream>
+#include <iterator>
+#include <utility>
+#include <tuple>       //std::forward_as_tuple
+#include <vector>
+#include <algorithm>   //std::max
+#include <cstdint>     //std::uint32_t
+#include <stdexcept>   //std::length_error
+#include <functional>  //std::less
+
+/** index of no node (the null link) */
+inline constexpr std::uint32_t _compact_nil = 0xFFFFFFFFu;
+
+/**
+ * ********* Compact nodes *********
+ *
+ * node of compact_bst: the pair and the indices of the two children in the array of the tree,
+ * with the height of the subtree (AVL); there is no parent link
+ * e.g. with int keys and values a node takes 20 bytes, against 40 of a node of bst (plus the malloc header)
+ */
+template<typename k_t, typename v_t>
+struct _compact_node {
+
+    using key_type = k_t;
+    using mapped_type = v_t;
+
+    std::pair<k_t, v_t> _pair;
+    std::uint32_t _left{_compact_nil};
+    std::uint32_t _right{_compact_nil};
+    std::uint8_t _height{1};
+
+    /** custom ctor - piecewise: the key and the value are constructed in place */
+    template<typename K, typename V>
+    _compact_node(std::piecewise_construct_t, K&& key_args, V&& value_args) :
+        _pair(std::piecewise_construct, std::forward<K>(key_args), std::forward<V>(value_args)) {}
+};
+
+/**
+ * path from the root to a node, as indices: the AVL height of a tree with less than 2^32 nodes
+ * is at most 46, so it fits in a fixed array
+ */
+struct _compact_path {
+    static constexpr std::uint32_t capacity = 48;
+    std::uint32_t nodes[capacity];
+    std::uint32_t depth{0};
+
+    void push(std::uint32_t n) noexcept {nodes[depth++] = n;}
+    std::uint32_t top() const noexcept {return nodes[depth - 1];}
+};
+
+
+template <typename k_t, typename v_t, typename OP>
+class compact_bst;
+
+/**
+ * *********  Class compact_bst iterator  **********
+ *
+ * bidirectional iterator over the keys of a compact_bst, in order
+ * without parent links the iterator keeps the path from the root to its node (a small stack of indices):
+ * ++ goes down the right subtree or pops the nodes left from their right child
+ * (the nodes can move when other keys are inserted: insertions and removals invalidate the iterators)
+ *
+ * @param O --> template for the iterator (key type, const or not)
+ * @param N --> template for the node type of the tree
+ */
+template<typename O, typename N>
+class _compact_iterator{
+
+    template<typename, typename, typename>
+    friend class compact_bst;
+
+    using node = N;
+    using v_t = typename node::mapped_type;
+    node* base{nullptr};              //array of the nodes of the tree
+    std::uint32_t root{_compact_nil};        //used by --end()
+    _compact_path path;                      //empty for end()
+
+    /** custom ctor: the node at the end of path */
+    _compact_iterator(node* b, std::uint32_t r, const _compact_path& p) noexcept : base{b}, root{r}, path{p} {}
+
+    /** goes down the left (right) children of the current node */
+    void _descend(bool left) noexcept {
+        for (;;) {
+            std::uint32_t next = left ? base[path.top()]._left : base[path.top()]._right;
+            if (next == _compact_nil) {
+                return;
+            }
+            path.push(next);
+        }
+    }
+
+    /** climbs while the node is the right (left) child of its parent: the parent is next (previous) */
+    void _climb(bool from_right) noexcept {
+        std::uint32_t n;
+        do {
+            n = path.nodes[--path.depth];
+        } while (path.depth && (from_right ? base[path.top()]._right : base[path.top()]._left) == n);
+    }
+
+ public:
+    using value_type = O;
+    using reference = value_type &;
+    using pointer = value_type *;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    /** default ctor */
+    _compact_iterator() noexcept = default;
+
+    /** custom ctor: end() of the tree with nodes b and root r */
+    _compact_iterator(node* b, std::uint32_t r) noexcept : base{b}, root{r} {}
+
+    /** pre-increment operator: the left most node of the right subtree, or the first ancestor on the right */
+    _compact_iterator& operator++() noexcept {
+        if (base[path.top()]._right != _compact_nil) {
+            path.push(base[path.top()]._right);
+            _descend(true);
+        }
+        else {
+            _climb(true);
+        }
+        return *this;
+    }
+
+    /** post-increment operator */
+    _compact_iterator operator++(int) noexcept {
+        auto tmp{*this};
+        ++(*this);
+        return tmp;
+    }
+
+    /** pre-decrement operator: decrementing end() gives the last element */
+    _compact_iterator& operator--() noexcept {
+        if (!path.depth) {
+            path.push(root);
+            _descend(false);
+        }
+        else if (base[path.top()]._left != _compact_nil) {
+            path.push(base[path.top()]._left);
+            _descend(false);
+        }
+        else {
+            _climb(false);
+        }
+        return *this;
+    }
+
+    /** post-decrement operator */
+    _compact_iterator operator--(int) noexcept {
+        auto tmp{*this};
+        --(*this);
+        return tmp;
+    }
+
+    /** arrow operator-> */
+    pointer operator->() const noexcept {return &**this;}
+
+    /** dereference operator*: returns the key of the element */
+    reference operator*() const noexcept {return base[path.top()]._pair.first;}
+
+    /** function value: returns the associated value of the element */
+    v_t& value() {return base[path.top()]._pair.second;}
+
+    /** function value - const */
+    const v_t& value() const {return base[path.top()]._pair.second;}
+
+    /** operator == */
+    friend
+    bool operator==(const _compact_iterator& a, const _compact_iterator& b) noexcept {
+        return a.path.depth == b.path.depth && (!a.path.depth || a.path.top() == b.path.top());
+    }
+
+    /** operator != */
+    friend
+    bool operator!=(const _compact_iterator& a, const _compact_iterator& b) noexcept {return !(a == b);}
+};
+
+
+/**
+ * ********* Class compact_bst **********
+ *
+ * alternative backend with the interface of bst, for small pairs: an AVL tree whose nodes live in one
+ * contiguous array (a std::vector) and refer to their children with 32-bit indices, without parent link.
+ * A node of int keys and values takes 20 bytes instead of the 40 of bst<int,int,std::less<int>,avl_balance>
+ * plus the malloc header, and the copy of the tree copies one array.
+ * Without parent links the insertions and removals retrace the heights through the path of their descent,
+ * and the iterators keep that path (see _compact_iterator).
+ * Erased nodes are reset to a default pair and reused by the next insertions (k_t and v_t must be default
+ * constructible and move assignable); shrink_to_fit packs the nodes in key order.
+ * At most 2^32 - 1 nodes (std::length_error otherwise)
+ *
+ * @param k_t --> template for key type
+ * @param v_t --> template for value type
+ * @param OP  --> template for Operator Comparison (OP) which is std::less<k_t>
+ */
+template <typename k_t, typename v_t, typename OP = std::less<k_t>>
+class compact_bst{
+
+ public:
+    using node = _compact_node<k_t, v_t>;
+
+ private:
+    using iterator = _compact_iterator<k_t, node>;
+    using const_iterator = _compact_iterator<const k_t, node>;
+
+    /** private members of the class */
+    std::vector<node> _nodes;        //all the nodes, erased ones included
+    std::uint32_t _root{_compact_nil};
+    std::uint32_t _free{_compact_nil};      //erased nodes, linked through _left
+    OP comp;                         //comparison
+    std::size_t _size{0};            //number of elements
+
+    /** the array of the nodes, for the iterators */
+    node* _base() const noexcept {return const_cast<node*>(_nodes.data());}
+
+    static int _height_of(const std::vector<node>& v, std::uint32_t n) noexcept {return n == _compact_nil ? 0 : v[n]._height;}
+
+    /** private function _update: recomputes the height of n from its children */
+    void _update(std::uint32_t n) noexcept {
+        node& x = _nodes[n];
+        x._height = static_cast<std::uint8_t>(1 + std::max(_height_of(_nodes, x._left), _height_of(_nodes, x._right)));
+    }
+
+    /** private function _rotate (left or right)
+     * @return returns the new root of the subtree of n */
+    std::uint32_t _rotate(std::uint32_t n, bool left) noexcept {
+        node& x = _nodes[n];
+        std::uint32_t c = left ? x._right : x._left;
+        node& y = _nodes[c];
+        if (left) {
+            x._right = y._left;
+            y._left = n;
+        }
+        else {
+            x._left = y._right;
+            y._right = n;
+        }
+        _update(n);
+        _update(c);
+        return c;
+    }
+
+    /** private function _fix
+     * updates the height of n and, if its children differ by two levels, rotates it
+     * @return returns the new root of the subtree of n */
+    std::uint32_t _fix(std::uint32_t n) noexcept;
+
+    /** private function _retrace
+     * fixes the nodes of path from the last one up to the root, relinking the rotated subtrees */
+    void _retrace(const _compact_path& path) noexcept;
+
+    /** private function _descend
+     * descends from the root towards x, storing the visited nodes in path
+     * @return returns true if the last node of path has key x */
+    template<typename K>
+    bool _descend(const K& x, _compact_path& path) const noexcept {
+        std::uint32_t n = _root;
+        while (n != _compact_nil) {
+            path.push(n);
+            const node& y = _nodes[n];
+            if (comp(x, y._pair.first)) {
+                n = y._left;
+            }
+            else if (comp(y._pair.first, x)) {
+                n = y._right;
+            }
+            else {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** private function _find
+     * @return returns an iterator (of type I) to the node with key x, or end() */
+    template<typename I, typename K>
+    I _find(const K& x) const noexcept {
+        I it{_base(), _root};
+        if (!_descend(x, it.path)) {
+            it.path.depth = 0;
+        }
+        return it;
+    }
+
+    /** private function _index
+     * @return returns the index of the node with key x, _compact_nil if there is none */
+    template<typename K>
+    std::uint32_t _index(const K& x) const noexcept {
+        std::uint32_t n = _root;
+        while (n != _compact_nil) {
+            const node& y = _nodes[n];
+            if (comp(x, y._pair.first)) {
+                n = y._left;
+            }
+            else if (comp(y._pair.first, x)) {
+                n = y._right;
+            }
+            else {
+                return n;
+            }
+        }
+        return _compact_nil;
+    }
+
+    /** private function _lower
+     * @return returns an iterator (of type I) to the first key not smaller than x, or end() */
+    template<typename I, typename K>
+    I _lower(const K& x) const noexcept {
+        I it{_base(), _root};
+        std::uint32_t found = 0;             // depth of the path to the result
+        std::uint32_t n = _root;
+        while (n != _compact_nil) {
+            it.path.push(n);
+            const node& y = _nodes[n];
+            if (comp(y._pair.first, x)) {
+                n = y._right;
+            }
+            else {
+                found = it.path.depth;
+                n = y._left;
+            }
+        }
+        it.path.depth = found;
+        return it;
+    }
+
+    /** private function _upper
+     * @return returns an iterator (of type I) to the first key greater than x, or end() */
+    template<typename I, typename K>
+    I _upper(const K& x) const noexcept {
+        I it{_base(), _root};
+        std::uint32_t found = 0;             // depth of the path to the result
+        std::uint32_t n = _root;
+        while (n != _compact_nil) {
+            it.path.push(n);
+            const node& y = _nodes[n];
+            if (!comp(x, y._pair.first)) {
+                n = y._right;
+            }
+            else {
+                found = it.path.depth;
+                n = y._left;
+            }
+        }
+        it.path.depth = found;
+        return it;
+    }
+
+    /** private function _make
+     * @return returns the index of a new node, taken from the erased ones if possible */
+    template<typename K, typename... Types>
+    std::uint32_t _make(K&& x, Types&&... args);
+
+    /** private function _pack
+     * builds a balanced subtree with the nodes [lo, lo + n) of _nodes, already in key order
+     * @return returns the index of its root */
+    std::uint32_t _pack(std::uint32_t lo, std::uint32_t n) noexcept;
+
+    template<typename K>
+    bool _erase(const K& x) noexcept;
+
+ public:
+
+    /** default ctor */
+    compact_bst() noexcept = default;
+
+    /** copy ctor - one copy of the array of the nodes */
+    compact_bst(const compact_bst& x) = default;
+
+    /** copy assignment */
+    compact_bst& operator=(const compact_bst& x) = default;
+
+    /** move ctor */
+    compact_bst(compact_bst&& x) noexcept :
+        _nodes{std::move(x._nodes)}, _root{std::exchange(x._root, _compact_nil)}, _free{std::exchange(x._free, _compact_nil)},
+        comp{std::move(x.comp)}, _size{std::exchange(x._size, 0)} {}
+
+    /** move assignment */
+    compact_bst& operator=(compact_bst&& x) noexcept {
+        if (this != &x) {
+            _nodes = std::move(x._nodes);
+            _root = std::exchange(x._root, _compact_nil);
+            _free = std::exchange(x._free, _compact_nil);
+            comp = std::move(x.comp);
+            _size = std::exchange(x._size, 0);
+            x._nodes.clear();
+        }
+        return *this;
+    }
+
+    /** function insert
+     * inserts a new node if the key is not present
+     * @return a pair of an iterator (pointing to the element with that key) and a bool (true if inserted) */
+    std::pair<iterator,bool> insert(const std::pair<k_t, v_t>& x) {return try_emplace(x.first, x.second);}
+
+    /** function insert - r-value */
+    std::pair<iterator,bool> insert(std::pair<k_t, v_t>&& x) {return try_emplace(std::move(x.first), std::move(x.second));}
+
+    /** function emplace
+     * @return a pair of an iterator and a bool (true if inserted), as insert */
+    template<class... Types>
+    std::pair<iterator,bool> emplace(Types&&... args) {
+        return insert(std::pair<k_t, v_t>{std::forward<Types>(args)...});
+    }
+
+    /** function try_emplace
+     * if there is no element with key x, inserts it with a value constructed from args
+     * the new node is linked where the descent stops and the heights are fixed along the same path
+     * @return a pair of an iterator (pointing to the element with key x) and a bool (true if inserted) */
+    template <typename... Types>
+    std::pair<iterator,bool> try_emplace(const k_t& x, Types&&... args) {return _try_emplace(x, std::forward<Types>(args)...);}
+
+    /** function try_emplace - r-value key */
+    template <typename... Types>
+    std::pair<iterator,bool> try_emplace(k_t&& x, Types&&... args) {return _try_emplace(std::move(x), std::forward<Types>(args)...);}
+
+    /** function find
+     * @return returns an iterator to the key or end() */
+    iterator find(const k_t& x) noexcept {return _find<iterator>(x);}
+
+    /** function find - const */
+    const_iterator find(const k_t& x) const noexcept {return _find<const_iterator>(x);}
+
+    /** function find - heterogeneous (only if OP is transparent) */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    iterator find(const K& x) noexcept {return _find<iterator>(x);}
+
+    /** function find - heterogeneous, const */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    const_iterator find(const K& x) const noexcept {return _find<const_iterator>(x);}
+
+    /** function contains
+     * @return returns true if there is an element with key x (the path is not stored) */
+    bool contains(const k_t& x) const noexcept {return _index(x) != _compact_nil;}
+
+    /** function contains - heterogeneous (only if OP is transparent) */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    bool contains(const K& x) const noexcept {return _index(x) != _compact_nil;}
+
+    /** function lower_bound
+     * @return returns an iterator to the first key not smaller than x, or end() */
+    iterator lower_bound(const k_t& x) noexcept {return _lower<iterator>(x);}
+
+    /** function lower_bound - const */
+    const_iterator lower_bound(const k_t& x) const noexcept {return _lower<const_iterator>(x);}
+
+    /** function upper_bound
+     * @return returns an iterator to the first key greater than x, or end() */
+    iterator upper_bound(const k_t& x) noexcept {return _upper<iterator>(x);}
+
+    /** function upper_bound - const */
+    const_iterator upper_bound(const k_t& x) const noexcept {return _upper<const_iterator>(x);}
+
+    /** function equal_range
+     * @return returns the pair lower_bound(x), upper_bound(x): the element with key x, if any */
+    std::pair<iterator, iterator> equal_range(const k_t& x) noexcept {
+        auto first = _lower<iterator>(x);
+        if (first != end() && !comp(x, *first)) {
+            return {first, std::next(first)};
+        }
+        return {first, first};
+    }
+
+    /** function equal_range - const */
+    std::pair<const_iterator, const_iterator> equal_range(const k_t& x) const noexcept {
+        auto first = _lower<const_iterator>(x);
+        if (first != end() && !comp(x, *first)) {
+            return {first, std::next(first)};
+        }
+        return {first, first};
+    }
+
+    /** function erase
+     * removes the element with key x, relinking its successor in its place, and puts its node in the free list
+     * @param x l-value reference of the key of the element to be deleted */
+    void erase(const k_t& x) {
+        if (!_erase(x)) {
+            std::cerr << "ERROR: there is no node with key = " << x << std::endl;
+        }
+    }
+
+    /** function clear: deletes all the nodes (the array keeps its capacity) */
+    void clear() noexcept {
+        _nodes.clear();
+        _root = _free = _compact_nil;
+        _size = 0;
+    }
+
+    /** function reserve: makes room for n nodes, so that the next insertions do not move the array */
+    void reserve(std::size_t n) {_nodes.reserve(n);}
+
+    /** function shrink_to_fit
+     * rebuilds the array with only the nodes in use, in key order and in balanced shape (the nodes
+     * visited by a descent are then near each other), and releases the memory left; O(n) */
+    void shrink_to_fit();
+
+    /** function size
+     * @return returns the number of elements */
+    std::size_t size() const noexcept {return _size;}
+
+    /** function empty */
+    bool empty() const noexcept {return _size == 0;}
+
+    /** function height
+     * @return returns the number of levels of the tree */
+    int height() const noexcept {return _height_of(_nodes, _root);}
+
+    /** function memory
+     * @return returns the bytes of the array of the nodes (its capacity, erased nodes included) */
+    std::size_t memory() const noexcept {return _nodes.capacity() * sizeof(node);}
+
+    /** function begin */
+    iterator begin() noexcept {
+        iterator it{_base(), _root};
+        if (_root != _compact_nil) {
+            it.path.push(_root);
+            it._descend(true);
+        }
+        return it;
+    }
+    const_iterator begin() const noexcept {
+        const_iterator it{_base(), _root};
+        if (_root != _compact_nil) {
+            it.path.push(_root);
+            it._descend(true);
+        }
+        return it;
+    }
+    const_iterator cbegin() const noexcept {return begin();}
+
+    /** function end */
+    iterator end() noexcept {return iterator{_base(), _root};}
+    const_iterator end() const noexcept {return const_iterator{_base(), _root};}
+    const_iterator cend() const noexcept {return end();}
+
+    /** subscripting operator
+     * returns a reference to the value mapped to x, inserting it if the key does not exist */
+    v_t& operator[](const k_t& x) {return try_emplace(x).first.value();}
+
+    /** subscripting operator - r-value */
+    v_t& operator[](k_t&& x) {return try_emplace(std::move(x)).first.value();}
+
+    /** put-to operator */
+    friend
+    std::ostream& operator<<(std::ostream& os, const compact_bst& x) {
+        if (!x._size) {
+            os << "WARNING: empty tree";
+            return os;
+        }
+        for (auto& key : x) {
+            os << key << " ";
+        }
+        os << '\n';
+        return os;
+    }
+
+ private:
+    template<typename K, typename... Types>
+    std::pair<iterator,bool> _try_emplace(K&& x, Types&&... args);
+};
+
+
+// definition of function _fix - out of the class
+template<typename k_t, typename v_t, typename OP>
+std::uint32_t compact_bst<k_t, v_t, OP>::_fix(std::uint32_t n) noexcept {
+    node& x = _nodes[n];
+    int balance = _height_of(_nodes, x._left) - _height_of(_nodes, x._right);
+    if (balance > 1) {
+        node& l = _nodes[x._left];
+        if (_height_of(_nodes, l._left) < _height_of(_nodes, l._right)) {
+            x._left = _rotate(x._left, true);           // left-right case
+        }
+        return _rotate(n, false);
+    }
+    if (balance < -1) {
+        node& r = _nodes[x._right];
+        if (_height_of(_nodes, r._right) < _height_of(_nodes, r._left)) {
+            x._right = _rotate(x._right, false);        // right-left case
+        }
+        return _rotate(n, true);
+    }
+    _update(n);
+    return n;
+}
+
+
+// definition of function _retrace - out of the class
+template<typename k_t, typename v_t, typename OP>
+void compact_bst<k_t, v_t, OP>::_retrace(const _compact_path& path) noexcept {
+    for (std::uint32_t d = path.depth; d-- > 0;) {
+        std::uint32_t n = path.nodes[d];
+        std::uint32_t top = _fix(n);
+        if (top == n) {
+            continue;
+        }
+        if (d == 0) {
+            _root = top;
+        }
+        else {
+            node& parent = _nodes[path.nodes[d - 1]];
+            (parent._left == n ? parent._left : parent._right) = top;
+        }
+    }
+}
+
+
+// definition of function _make - out of the class
+template<typename k_t, typename v_t, typename OP>
+template<typename K, typename... Types>
+std::uint32_t compact_bst<k_t, v_t, OP>::_make(K&& x, Types&&... args) {
+    if (_free != _compact_nil) {
+        std::uint32_t i = _free;
+        node& n = _nodes[i];
+        n._pair = std::pair<k_t, v_t>(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(x)),
+                                      std::forward_as_tuple(std::forward<Types>(args)...));
+        _free = n._left;
+        n._left = n._right = _compact_nil;
+        n._height = 1;
+        return i;
+    }
+    if (_nodes.size() >= _compact_nil) {
+        throw std::length_error("compact_bst: more than 2^32 - 1 nodes");
+    }
+    _nodes.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(x)),
+                        std::forward_as_tuple(std::forward<Types>(args)...));
+    return static_cast<std::uint32_t>(_nodes.size() - 1);
+}
+
+
+// definition of function _try_emplace - out of the class
+template<typename k_t, typename v_t, typename OP>
+template<typename K, typename... Types>
+std::pair<typename compact_bst<k_t, v_t, OP>::iterator, bool>
+compact_bst<k_t, v_t, OP>::_try_emplace(K&& x, Types&&... args) {
+    _compact_path path;
+    if (_descend(x, path)) {
+        return std::pair<iterator, bool>{iterator{_base(), _root, path}, false};
+    }
+    bool left = path.depth && comp(x, _nodes[path.top()]._pair.first);
+    std::uint32_t fresh = _make(std::forward<K>(x), std::forward<Types>(args)...);   // may move the array
+    if (!path.depth) {
+        _root = fresh;
+    }
+    else {
+        (left ? _nodes[path.top()]._left : _nodes[path.top()]._right) = fresh;
+    }
+    _retrace(path);
+    ++_size;
+    // the rotations may have changed the path to the new node: it is found again (in cache)
+    return std::pair<iterator, bool>{_find<iterator>(_nodes[fresh]._pair.first), true};
+}
+
+
+// definition of function _erase - out of the class
+template<typename k_t, typename v_t, typename OP>
+template<typename K>
+bool compact_bst<k_t, v_t, OP>::_erase(const K& x) noexcept {
+    _compact_path path;
+    if (!_descend(x, path)) {
+        return false;
+    }
+    std::uint32_t at = path.depth - 1;                   // position of n in the path
+    std::uint32_t n = path.nodes[at];
+    node& y = _nodes[n];
+    std::uint32_t replacement;
+
+    if (y._left == _compact_nil || y._right == _compact_nil) {        // the only child takes the place of n
+        replacement = y._left != _compact_nil ? y._left : y._right;
+        path.depth = at;                                 // retraced from the parent of n
+    }
+    else {                                               // the successor takes the place of n
+        std::uint32_t s = y._right;
+        path.push(s);
+        while (_nodes[s]._left != _compact_nil) {
+            s = _nodes[s]._left;
+            path.push(s);
+        }
+        std::uint32_t s_parent = path.nodes[path.depth - 2];
+        if (s_parent != n) {                             // the right subtree of s goes to its parent
+            _nodes[s_parent]._left = _nodes[s]._right;
+            _nodes[s]._right = y._right;
+        }
+        _nodes[s]._left = y._left;
+        _nodes[s]._height = y._height;
+        path.nodes[at] = s;
+        --path.depth;                                    // retraced from the old parent of s (or from s)
+        replacement = s;
+    }
+
+    if (at == 0) {
+        _root = replacement;
+    }
+    else {
+        node& parent = _nodes[path.nodes[at - 1]];
+        (parent._left == n ? parent._left : parent._right) = replacement;
+    }
+    _retrace(path);
+
+    y._pair = std::pair<k_t, v_t>{};                     // the resources of the pair are released now
+    y._left = _free;
+    y._right = _compact_nil;
+    _free = n;
+    --_size;
+    return true;
+}
+
+
+// definition of function _pack - out of the class
+template<typename k_t, typename v_t, typename OP>
+std::uint32_t compact_bst<k_t, v_t, OP>::_pack(std::uint32_t lo, std::uint32_t n) noexcept {
+    if (n == 0) {
+        return _compact_nil;
+    }
+    std::uint32_t left_size = (n - 1) / 2;
+    std::uint32_t mid = lo + left_size;
+    _nodes[mid]._left = _pack(lo, left_size);
+    _nodes[mid]._right = _pack(mid + 1, n - 1 - left_size);
+    _update(mid);
+    return mid;
+}
+
+
+// definition of function shrink_to_fit - out of the class
+template<typename k_t, typename v_t, typename OP>
+void compact_bst<k_t, v_t, OP>::shrink_to_fit() {
+    std::vector<node> packed;
+    packed.reserve(_size);
+    for (auto it = begin(); it != end(); ++it) {
+        packed.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::move(*it)),
+                            std::forward_as_tuple(std::move(it.value())));
+    }
+    _nodes = std::move(packed);
+    _free = _compact_nil;
+    _root = _pack(0, static_cast<std::uint32_t>(_size));
+}
+
+#endif
@@ -0,0 +1,480 @@
+#ifndef _bst_concurrent
+#define _bst_concurrent
+
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <thread>      //std::this_thread::yield
+#include <optional>
+#include <vector>
+#include <utility>
+#include <functional>  //std::less
+#include <cstdint>     //std::uint64_t
+#include <algorithm>   //std::max
+
+/**
+ * ********* Class concurrent node *********
+ *
+ * node of a concurrent_bst: immutable once built (pair, children and height), it becomes visible
+ * to the readers through the atomic store of the root which publishes the path it belongs to
+ */
+template<typename k_t, typename v_t>
+struct _cnode {
+
+    /** pair of key and value */
+    const std::pair<k_t, v_t> _pair;
+    /** pointer to left child */
+    _cnode* const _left;
+    /** pointer to right child */
+    _cnode* const _right;
+    /** height of the subtree rooted at the node (a leaf has height 1) */
+    const int _height;
+
+    /** custom ctor: the height follows from the children */
+    template<typename P>
+    _cnode(P&& pair, _cnode* left, _cnode* right) :
+        _pair(std::forward<P>(pair)), _left{left}, _right{right},
+        _height{1 + std::max(left ? left->_height : 0, right ? right->_height : 0)} {}
+};
+
+
+/**
+ * ********* Class concurrent_bst **********
+ *
+ * AVL tree shared by many threads: readers never lock, writers are serialized by a mutex
+ *
+ * readers (find, contains, for_each) start from the atomic root and are never blocked by writers:
+ * the nodes are never modified, and insert and erase build new copies of the O(log n) nodes on the
+ * path from the root, rebalanced with new nodes as in persistent_bst, then publish the new root
+ * with a single atomic store; a reader sees the tree either before or after each insertion or removal
+ * every update copies the root, so the writers would conflict on it anyway: one mutex serializes them
+ * the nodes are never modified after they are reachable, so values are returned by copy
+ *
+ * the nodes left out of the new version are freed with epoch-based reclamation: a reader announces
+ * the global epoch in a slot while it walks the tree; a node retired at epoch t is freed once every
+ * announced epoch is greater than t, i.e. when no reader that may have seen it is still running
+ *
+ * @param k_t --> template for key type
+ * @param v_t --> template for value type
+ * @param OP  --> template for Operator Comparison (OP) which is std::less<k_t>
+ */
+template <typename k_t, typename v_t, typename OP = std::less<k_t>>
+class concurrent_bst{
+
+    using node = _cnode<k_t, v_t>;
+
+    /** number of reader slots: more concurrent readers wait for a free slot */
+    static constexpr std::size_t _slots = 128;
+    /** number of nodes retired between two reclamations */
+    static constexpr std::size_t _reclaim_every = 1024;
+
+    /** epoch announced by a reader (0 if free), alone in its cache line */
+    struct alignas(64) _slot {
+        std::atomic<std::uint64_t> _epoch{0};
+    };
+
+    /** a node unlinked from the tree at a given epoch */
+    struct _retired {
+        node* _node;
+        std::uint64_t _epoch;
+    };
+
+    /** private members of the class */
+    std::atomic<node*> _root{nullptr};
+    OP comp;                                    //comparison
+    std::atomic<std::size_t> _size{0};          //number of nodes
+    std::mutex _writer;                         //held by insert and erase
+    std::atomic<std::uint64_t> _epoch{1};       //global epoch
+    mutable _slot _readers[_slots];             //epochs announced by the readers
+    std::vector<_retired> _retired_nodes;       //nodes waiting to be freed (guarded by _writer)
+    std::size_t _reclaim_at{_reclaim_every};    //size of _retired_nodes that triggers a reclamation
+    std::vector<node*> _fresh;                  //nodes built by the running update (guarded by _writer)
+    std::vector<node*> _garbage;                //nodes left out by the running update (guarded by _writer)
+
+    /**
+     * ********* Class guard *********
+     * announces the epoch of a reader for the duration of its walk in the tree
+     */
+    class _guard {
+        _slot* _s;
+
+     public:
+        explicit _guard(const concurrent_bst& t) noexcept : _s{nullptr} {
+            thread_local std::size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id()) % _slots;
+            std::uint64_t e = t._epoch.load();
+            for (std::size_t tries = 1;; ++tries) {
+                std::uint64_t free = 0;
+                if (t._readers[hint]._epoch.compare_exchange_strong(free, e)) {     // claims a free slot
+                    std::atomic_thread_fence(std::memory_order_seq_cst);            // announced before the first load of the walk
+                    _s = &t._readers[hint];
+                    return;
+                }
+                hint = (hint + 1) % _slots;
+                if (tries % _slots == 0) {
+                    std::this_thread::yield();                                      // all the slots are busy
+                }
+            }
+        }
+
+        ~_guard() {_s->_epoch.store(0, std::memory_order_release);}
+
+        _guard(const _guard&) = delete;
+        _guard& operator=(const _guard&) = delete;
+    };
+
+    /** private function _locate
+     * walks the tree from the root loaded with acquire (readers)
+     * @return returns the node with key x, nullptr if there is none */
+    node* _locate(const k_t& x) const noexcept {
+        node* tmp = _root.load(std::memory_order_acquire);
+        while (tmp) {
+            if (comp(x, tmp->_pair.first)) {
+                tmp = tmp->_left;
+            }
+            else if (comp(tmp->_pair.first, x)) {
+                tmp = tmp->_right;
+            }
+            else {
+                return tmp;
+            }
+        }
+        return nullptr;
+    }
+
+    /** height of a subtree, 0 for an empty one */
+    static int _height_of(const node* n) noexcept {return n ? n->_height : 0;}
+
+    /** private function _make
+     * @return returns a new node, recorded in _fresh until the update is published (writers only) */
+    template<typename P>
+    node* _make(P&& pair, node* left, node* right) {
+        _fresh.push_back(nullptr);
+        return _fresh.back() = new node{std::forward<P>(pair), left, right};
+    }
+
+    node* _balance(const std::pair<k_t, v_t>& pair, node* left, node* right);
+    template<typename P>
+    node* _insert(node* n, P&& x, bool& inserted);
+    node* _erase(node* n, const k_t& x, bool& erased);
+    node* _erase_min(node* n, const node*& min);
+    void _publish(node* root);
+    void _reclaim();
+
+    /** private function _destroy
+     * deletes the subtree rooted at n (no reader may be running) */
+    static void _destroy(node* n) noexcept {
+        std::vector<node*> stack;
+        while (n) {
+            if (n->_left) {
+                stack.push_back(n->_left);
+            }
+            if (n->_right) {
+                stack.push_back(n->_right);
+            }
+            delete n;
+            if (stack.empty()) {
+                break;
+            }
+            n = stack.back();
+            stack.pop_back();
+        }
+    }
+
+    /** private function _update
+     * runs f, which builds the new version of the tree from the root, and publishes it;
+     * if f throws, the nodes it built are deleted and the tree does not change (writers only) */
+    template<typename F>
+    bool _update(F&& f) {
+        std::lock_guard<std::mutex> lock{_writer};
+        _fresh.clear();
+        _garbage.clear();
+        bool changed = false;
+        node* root = _root.load(std::memory_order_relaxed);
+        try {
+            root = f(root, changed);
+            if (changed) {
+                _retired_nodes.reserve(_retired_nodes.size() + _garbage.size());   // _publish cannot fail
+            }
+        }
+        catch (...) {
+            for (auto n : _fresh) {
+                delete n;
+            }
+            throw;
+        }
+        if (changed) {
+            _publish(root);
+        }
+        return changed;
+    }
+
+ public:
+
+    /** default ctor */
+    concurrent_bst() = default;
+
+    /** dtor: no thread may use the tree any more */
+    ~concurrent_bst() {
+        _destroy(_root.load());
+        for (auto& r : _retired_nodes) {
+            delete r._node;
+        }
+    }
+
+    concurrent_bst(const concurrent_bst&) = delete;
+    concurrent_bst& operator=(const concurrent_bst&) = delete;
+
+    /** function insert
+     * inserts the pair if its key is not present (writers are serialized)
+     * @return returns true if the pair has been inserted */
+    bool insert(const std::pair<k_t, v_t>& x) {
+        bool inserted = _update([this, &x](node* root, bool& changed) {return _insert(root, x, changed);});
+        _size.fetch_add(inserted, std::memory_order_relaxed);
+        return inserted;
+    }
+
+    /** function insert - r-value */
+    bool insert(std::pair<k_t, v_t>&& x) {
+        bool inserted = _update([this, &x](node* root, bool& changed) {return _insert(root, std::move(x), changed);});
+        _size.fetch_add(inserted, std::memory_order_relaxed);
+        return inserted;
+    }
+
+    /** function emplace
+     * @return returns true if the pair has been inserted */
+    template<class... Types>
+    bool emplace(Types&&... args) {return insert(std::pair<k_t, v_t>{std::forward<Types>(args)...});}
+
+    /** function erase
+     * removes the node with key x; the nodes left out are freed when no reader can see them any more
+     * @return returns true if a node has been removed */
+    bool erase(const k_t& x) {
+        bool erased = _update([this, &x](node* root, bool& changed) {return _erase(root, x, changed);});
+        _size.fetch_sub(erased, std::memory_order_relaxed);
+        return erased;
+    }
+
+    /** function find
+     * lock-free: never waits for the writers
+     * @return returns a copy of the value associated to x, if present */
+    std::optional<v_t> find(const k_t& x) const {
+        _guard g{*this};
+        node* n = _locate(x);
+        return n ? std::optional<v_t>{n->_pair.second} : std::nullopt;
+    }
+
+    /** function contains - lock-free
+     * @return returns true if there is a node with key x */
+    bool contains(const k_t& x) const noexcept {
+        _guard g{*this};
+        return _locate(x) != nullptr;
+    }
+
+    /** function for_each
+     * calls f(key, value) for all the nodes, in order, without locking
+     * the walk sees the version of the tree published when it starts */
+    template<typename F>
+    void for_each(F&& f) const {
+        _guard g{*this};
+        std::vector<node*> stack;
+        node* tmp = _root.load(std::memory_order_acquire);
+        while (tmp || !stack.empty()) {
+            while (tmp) {                                       // in-order walk without parent pointers
+                stack.push_back(tmp);
+                tmp = tmp->_left;
+            }
+            tmp = stack.back();
+            stack.pop_back();
+            f(tmp->_pair.first, tmp->_pair.second);
+            tmp = tmp->_right;
+        }
+    }
+
+    /** function size
+     * @return returns the number of nodes */
+    std::size_t size() const noexcept {return _size.load(std::memory_order_relaxed);}
+
+    /** function height
+     * @return returns the height of the tree, O(log n) with AVL balancing (0 if empty) */
+    int height() const noexcept {
+        _guard g{*this};
+        return _height_of(_root.load(std::memory_order_acquire));
+    }
+
+    /** put-to operator */
+    friend
+    std::ostream& operator<<(std::ostream& os, const concurrent_bst& x) {
+        if (!x.size()) {
+            os << "WARNING: empty tree";
+            return os;
+        }
+        x.for_each([&os](const k_t& key, const v_t&) {os << key << " ";});
+        os << '\n';
+        return os;
+    }
+};
+
+
+// definition of function _balance - out of the class
+/** function _balance
+ * builds a node with the given pair and children, restoring the AVL property with new nodes
+ * (a single or double rotation) if the heights of the children differ by two;
+ * the children replaced by a rotation are recorded in _garbage
+ * @return returns the root of the new subtree */
+template<typename k_t, typename v_t, typename OP>
+typename concurrent_bst<k_t, v_t, OP>::node*
+concurrent_bst<k_t, v_t, OP>::_balance(const std::pair<k_t, v_t>& pair, node* left, node* right) {
+    int diff = _height_of(left) - _height_of(right);
+    if (diff > 1) {                                                 // left heavy
+        _garbage.push_back(left);
+        if (_height_of(left->_left) >= _height_of(left->_right)) {  // left-left case
+            return _make(left->_pair, left->_left, _make(pair, left->_right, right));
+        }
+        node* lr = left->_right;                                    // left-right case
+        _garbage.push_back(lr);
+        return _make(lr->_pair, _make(left->_pair, left->_left, lr->_left), _make(pair, lr->_right, right));
+    }
+    if (diff < -1) {                                                // right heavy
+        _garbage.push_back(right);
+        if (_height_of(right->_right) >= _height_of(right->_left)) {  // right-right case
+            return _make(right->_pair, _make(pair, left, right->_left), right->_right);
+        }
+        node* rl = right->_left;                                    // right-left case
+        _garbage.push_back(rl);
+        return _make(rl->_pair, _make(pair, left, rl->_left), _make(right->_pair, rl->_right, right->_right));
+    }
+    return _make(pair, left, right);
+}
+
+
+// definition of function _insert - out of the class
+/** function _insert
+ * inserts x in the subtree rooted at n; the nodes copied are recorded in _garbage
+ * @return returns the new root of the subtree, n itself if the key is present */
+template<typename k_t, typename v_t, typename OP>
+template<typename P>
+typename concurrent_bst<k_t, v_t, OP>::node*
+concurrent_bst<k_t, v_t, OP>::_insert(node* n, P&& x, bool& inserted) {
+    if (!n) {
+        inserted = true;
+        return _make(std::forward<P>(x), nullptr, nullptr);
+    }
+    if (comp(x.first, n->_pair.first)) {
+        node* left = _insert(n->_left, std::forward<P>(x), inserted);
+        if (left == n->_left) {
+            return n;
+        }
+        _garbage.push_back(n);
+        return _balance(n->_pair, left, n->_right);
+    }
+    if (comp(n->_pair.first, x.first)) {
+        node* right = _insert(n->_right, std::forward<P>(x), inserted);
+        if (right == n->_right) {
+            return n;
+        }
+        _garbage.push_back(n);
+        return _balance(n->_pair, n->_left, right);
+    }
+    return n;                                           // the key is present: the tree does not change
+}
+
+
+// definition of function _erase_min - out of the class
+/** function _erase_min
+ * removes the smallest node of the subtree rooted at n (not empty), which is returned in min
+ * @return returns the new root of the subtree */
+template<typename k_t, typename v_t, typename OP>
+typename concurrent_bst<k_t, v_t, OP>::node*
+concurrent_bst<k_t, v_t, OP>::_erase_min(node* n, const node*& min) {
+    _garbage.push_back(n);
+    if (!n->_left) {
+        min = n;
+        return n->_right;
+    }
+    node* left = _erase_min(n->_left, min);
+    return _balance(n->_pair, left, n->_right);
+}
+
+
+// definition of function _erase - out of the class
+/** function _erase
+ * removes the node with key x from the subtree rooted at n; the nodes copied are recorded in _garbage
+ * @return returns the new root of the subtree, n itself if x is not present */
+template<typename k_t, typename v_t, typename OP>
+typename concurrent_bst<k_t, v_t, OP>::node*
+concurrent_bst<k_t, v_t, OP>::_erase(node* n, const k_t& x, bool& erased) {
+    if (!n) {
+        return n;
+    }
+    if (comp(x, n->_pair.first)) {
+        node* left = _erase(n->_left, x, erased);
+        if (!erased) {
+            return n;
+        }
+        _garbage.push_back(n);
+        return _balance(n->_pair, left, n->_right);
+    }
+    if (comp(n->_pair.first, x)) {
+        node* right = _erase(n->_right, x, erased);
+        if (!erased) {
+            return n;
+        }
+        _garbage.push_back(n);
+        return _balance(n->_pair, n->_left, right);
+    }
+    erased = true;
+    _garbage.push_back(n);
+    if (!n->_left || !n->_right) {
+        return n->_left ? n->_left : n->_right;
+    }
+    const node* successor = nullptr;                    // a copy of the successor takes the place of n
+    node* right = _erase_min(n->_right, successor);
+    return _balance(successor->_pair, n->_left, right);
+}
+
+
+// definition of function _publish - out of the class
+/** function _publish
+ * makes the new version visible with a single release store of the root, then retires the nodes
+ * left out of it with the current epoch (writers only, _retired_nodes has room for _garbage) */
+template<typename k_t, typename v_t, typename OP>
+void concurrent_bst<k_t, v_t, OP>::_publish(node* root) {
+    _root.store(root, std::memory_order_release);      // the new nodes are complete before they are visible
+    std::uint64_t e = _epoch.load();
+    for (auto n : _garbage) {
+        _retired_nodes.push_back(_retired{n, e});
+    }
+    if (_retired_nodes.size() >= _reclaim_at) {
+        _reclaim();
+        _reclaim_at = _retired_nodes.size() + _reclaim_every;
+    }
+}
+
+
+// definition of function _reclaim - out of the class
+/** function _reclaim
+ * starts a new epoch and frees the retired nodes that no running reader may have seen:
+ * those retired before the smallest epoch announced by a reader (writers only) */
+template<typename k_t, typename v_t, typename OP>
+void concurrent_bst<k_t, v_t, OP>::_reclaim() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);    // pairs with the fence of _guard: the unlinking stores come before the scan
+    std::uint64_t oldest = _epoch.fetch_add(1) + 1;
+    for (auto& s : _readers) {
+        std::uint64_t e = s._epoch.load();
+        if (e && e < oldest) {
+            oldest = e;
+        }
+    }
+    std::size_t kept = 0;
+    for (auto& r : _retired_nodes) {
+        if (r._epoch < oldest) {
+            delete r._node;
+        }
+        else {
+            _retired_nodes[kept++] = r;
+        }
+    }
+    _retired_nodes.resize(kept);
+}
+
+#endif
@@ -0,0 +1,402 @@
+#ifndef _bst_frozen
+#define _bst_frozen
+#include "traits.hpp"
+#include "serialize.hpp"
+
+#include <iostream>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <memory>      //std::shared_ptr
+#include <new>         //std::align_val_t
+#include <functional>  //std::less
+#include <algorithm>   //std::max
+
+/**
+ * ********* Eytzinger layout *********
+ *
+ * a sorted sequence of n keys stored as a complete binary tree in an array, in BFS order:
+ * the root is at index 1, the children of k at 2k and 2k + 1 (index 0 is not used)
+ * a descent reads the array from the front, and the 16 descendants of k at depth four
+ * (for 4 byte keys) are contiguous, so they can be prefetched with one cache line
+ */
+
+
+/** _eytzinger_first: index of the smallest key, 0 if n == 0 */
+inline std::size_t _eytzinger_first(std::size_t n) noexcept {
+    std::size_t k = n ? 1 : 0;
+    while (2 * k <= n && k) {
+        k = 2 * k;
+    }
+    return k;
+}
+
+/** _eytzinger_last: index of the largest key, 0 if n == 0 */
+inline std::size_t _eytzinger_last(std::size_t n) noexcept {
+    std::size_t k = n ? 1 : 0;
+    while (2 * k + 1 <= n && k) {
+        k = 2 * k + 1;
+    }
+    return k;
+}
+
+/** _eytzinger_next: index of the key following the one at k in order, 0 after the last */
+inline std::size_t _eytzinger_next(std::size_t k, std::size_t n) noexcept {
+    if (2 * k + 1 <= n) {               // leftmost node of the right subtree
+        k = 2 * k + 1;
+        while (2 * k <= n) {
+            k = 2 * k;
+        }
+        return k;
+    }
+    while (k & 1) {                     // climb while k is a right child, then once more
+        k >>= 1;
+    }
+    return k >> 1;
+}
+
+/** _eytzinger_prev: index of the key preceding the one at k in order, 0 before the first */
+inline std::size_t _eytzinger_prev(std::size_t k, std::size_t n) noexcept {
+    if (2 * k <= n) {                   // rightmost node of the left subtree
+        k = 2 * k;
+        while (2 * k + 1 <= n) {
+            k = 2 * k + 1;
+        }
+        return k;
+    }
+    while (k && !(k & 1)) {             // climb while k is a left child, then once more
+        k >>= 1;
+    }
+    return k >> 1;
+}
+
+
+/**
+ * ********* _aligned_allocator *********
+ *
+ * allocator of cache line aligned arrays, so that the prefetched blocks of the Eytzinger array
+ * do not straddle two cache lines
+ */
+template<typename T, std::size_t Align = 64>
+struct _aligned_allocator {
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {using other = _aligned_allocator<U, Align>;};
+
+    _aligned_allocator() noexcept = default;
+    template<typename U>
+    _aligned_allocator(const _aligned_allocator<U, Align>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{std::max(Align, alignof(T))}));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept {
+        ::operator delete(static_cast<void*>(p), std::align_val_t{std::max(Align, alignof(T))});
+    }
+
+    friend bool operator==(const _aligned_allocator&, const _aligned_allocator&) noexcept {return true;}
+    friend bool operator!=(const _aligned_allocator&, const _aligned_allocator&) noexcept {return false;}
+};
+
+
+/**
+ * *********  Class frozen iterator  **********
+ *
+ * bidirectional iterator over the keys of a frozen_bst, in order
+ * every instance is an index of the Eytzinger array (0 for end()) and a pointer to the tree
+ *
+ * @param F --> template for the frozen tree type
+ */
+template<typename F>
+class _frozen_iterator{
+
+    using tree = F;
+    using v_t = typename tree::mapped_type;
+    const tree* frozen{nullptr};      //the tree
+    std::size_t current{0};           //index of the key in the Eytzinger array, 0 for end()
+
+ public:
+    using value_type = const typename tree::key_type;
+    using reference = value_type &;
+    using pointer = value_type *;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    /** default ctor */
+    _frozen_iterator() noexcept = default;
+
+    /** custom ctor: the key at index k of the array of t */
+    _frozen_iterator(const tree* t, std::size_t k) noexcept : frozen{t}, current{k} {}
+
+    /** function index: returns the index of the key in the Eytzinger array */
+    std::size_t index() const noexcept {return current;}
+
+    /** pre-increment operator */
+    _frozen_iterator& operator++() noexcept {
+        current = _eytzinger_next(current, frozen->size());
+        return *this;
+    }
+
+    /** post-increment operator */
+    _frozen_iterator operator++(int) noexcept {
+        auto tmp{*this};
+        ++(*this);
+        return tmp;
+    }
+
+    /** pre-decrement operator: decrementing end() gives the last key */
+    _frozen_iterator& operator--() noexcept {
+        current = current ? _eytzinger_prev(current, frozen->size()) : _eytzinger_last(frozen->size());
+        return *this;
+    }
+
+    /** post-decrement operator */
+    _frozen_iterator operator--(int) noexcept {
+        auto tmp{*this};
+        --(*this);
+        return tmp;
+    }
+
+    /** arrow operator-> */
+    pointer operator->() const noexcept {return &**this;}
+
+    /** dereference operator*: returns the key */
+    reference operator*() const noexcept {return frozen->_key_at(current);}
+
+    /** function value: returns the associated value */
+    const v_t& value() const noexcept {return frozen->_value_at(current);}
+
+    /** operator == */
+    friend
+    bool operator==(const _frozen_iterator& a, const _frozen_iterator& b) noexcept {return a.current == b.current;}
+
+    /** operator != */
+    friend
+    bool operator!=(const _frozen_iterator& a, const _frozen_iterator& b) noexcept {return !(a == b);}
+};
+
+
+/**
+ * ********* Class frozen_bst **********
+ *
+ * read-only snapshot of a tree, for the workloads that build a tree once and query it many times
+ * the keys are stored in one contiguous array in Eytzinger order and the values in a parallel array
+ * a lookup is a branchless descent of the array (the next index is computed from the result
+ * of the comparison) which prefetches the cache line of the descendants four levels below
+ * it is built by bst::freeze(), or from any tree whose iterators give the keys in order
+ * (operator*) and their values (function value), or mapped from a file by load
+ * the arrays are never modified, so the copies of a snapshot share them
+ *
+ * @param k_t --> template for key type (default constructible)
+ * @param v_t --> template for value type (default constructible)
+ * @param OP  --> template for Operator Comparison (OP) which is std::less<k_t>
+ */
+template <typename k_t, typename v_t, typename OP = std::less<k_t>>
+class frozen_bst{
+
+ public:
+    using key_type = k_t;
+    using mapped_type = v_t;
+    using const_iterator = _frozen_iterator<frozen_bst>;
+    using iterator = const_iterator;
+
+ private:
+    friend const_iterator;
+
+    /** keys per cache line: the descendants of k at depth log2(_block) are at _block * k, ... */
+    static constexpr std::size_t _block = std::max<std::size_t>(1, 64 / sizeof(k_t));
+
+    /** arrays of a snapshot built in memory */
+    struct _arrays {
+        std::vector<k_t, _aligned_allocator<k_t>> keys;
+        std::vector<v_t> values;
+    };
+
+    /** private members of the class */
+    std::shared_ptr<const void> _storage;     //owner of the arrays: _arrays, or the mapping of a file
+    const k_t* _keys{nullptr};                //keys in Eytzinger order, _keys[0] not used
+    const v_t* _values{nullptr};              //values, parallel to _keys
+    std::size_t _size{0};                     //number of keys
+    OP comp;                                  //comparison
+
+    const k_t& _key_at(std::size_t k) const noexcept {return _keys[k];}
+    const v_t& _value_at(std::size_t k) const noexcept {return _values[k];}
+
+    /** private function _lower
+     * branchless descent: goes right if the key is smaller than x, left otherwise
+     * at the end, the last left turn is the first key not smaller than x: the trailing
+     * right turns (ones) and the left turn (a zero) are removed from the path
+     * @return returns the index of the first key not smaller than x, 0 if there is none */
+    template<typename K>
+    std::size_t _lower(const K& x) const noexcept {
+        const k_t* keys = _keys;
+        std::size_t n = _size;
+        std::size_t k = 1;
+        while (k <= n) {
+#if defined(__GNUC__)
+            __builtin_prefetch(keys + _block * k);
+#endif
+            k = 2 * k + static_cast<std::size_t>(comp(keys[k], x));
+        }
+#if defined(__GNUC__)
+        k >>= __builtin_ffsll(static_cast<long long>(~k));
+#else
+        while (k & 1) {
+            k >>= 1;
+        }
+        k >>= 1;
+#endif
+        return k;
+    }
+
+    /** private function _find
+     * @return returns the index of the key x, 0 if it is not present */
+    template<typename K>
+    std::size_t _find(const K& x) const noexcept {
+        std::size_t k = _lower(x);
+        return k && !comp(x, _keys[k]) ? k : 0;
+    }
+
+ public:
+
+    /** default ctor: empty snapshot */
+    frozen_bst() = default;
+
+    /**
+     * custom ctor
+     * copies the keys and the values of a tree, visiting it once in order
+     * @param tree --> a bst (or any tree with ordered iterators and function value) ordered by OP
+     */
+    template<typename T>
+    explicit frozen_bst(const T& tree, OP op = OP{}) :
+        frozen_bst{tree, static_cast<std::size_t>(std::distance(tree.begin(), tree.end())), op} {}
+
+    /**
+     * custom ctor - known size
+     * as the previous one, for trees that know their number of keys n: the tree is visited only once
+     */
+    template<typename T>
+    frozen_bst(const T& tree, std::size_t n, OP op) : comp{op} {
+        auto arrays = std::make_shared<_arrays>();
+        arrays->keys.resize(n + 1);
+        arrays->values.resize(n + 1);
+        std::size_t k = _eytzinger_first(n);
+        for (auto it = tree.begin(); it != tree.end(); ++it) {     // in-order visit of the implicit tree
+            arrays->keys[k] = *it;
+            arrays->values[k] = it.value();
+            k = _eytzinger_next(k, n);
+        }
+        _keys = arrays->keys.data();
+        _values = arrays->values.data();
+        _size = n;
+        _storage = std::move(arrays);
+    }
+
+    /** function save
+     * writes the snapshot to a file in the flat layout (see serialize.hpp): the arrays are written
+     * as they are, so load can map them back without parsing
+     * throws std::runtime_error if the file cannot be written */
+    void save(const std::string& path) const;
+
+    /** function load
+     * maps a file written by save (or by bst::save) read-only in memory: the snapshot searches
+     * the file in place, with no parsing and no allocation per key; the pages are read on first access
+     * throws std::runtime_error if the file cannot be mapped or was saved with other types
+     * @return returns the snapshot, which keeps the mapping alive (as do its copies) */
+    static frozen_bst load(const std::string& path, OP op = OP{});
+
+    /** function size: returns the number of keys */
+    std::size_t size() const noexcept {return _size;}
+
+    /** function empty */
+    bool empty() const noexcept {return size() == 0;}
+
+    /** function find
+     *  @return returns an iterator to the key or end() */
+    const_iterator find(const k_t& x) const noexcept {return const_iterator{this, _find(x)};}
+
+    /** function find - heterogeneous (only if OP is transparent) */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    const_iterator find(const K& x) const noexcept {return const_iterator{this, _find(x)};}
+
+    /** function contains */
+    bool contains(const k_t& x) const noexcept {return _find(x) != 0;}
+
+    /** function contains - heterogeneous (only if OP is transparent) */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    bool contains(const K& x) const noexcept {return _find(x) != 0;}
+
+    /** function lower_bound
+     *  @return returns an iterator to the first key not smaller than x, or end() */
+    const_iterator lower_bound(const k_t& x) const noexcept {return const_iterator{this, _lower(x)};}
+
+    /** function lower_bound - heterogeneous (only if OP is transparent) */
+    template<typename K, typename O = OP, typename = typename O::is_transparent>
+    const_iterator lower_bound(const K& x) const noexcept {return const_iterator{this, _lower(x)};}
+
+    /** function begin */
+    const_iterator begin() const noexcept {return const_iterator{this, _eytzinger_first(size())};}
+    const_iterator cbegin() const noexcept {return begin();}
+
+    /** function end */
+    const_iterator end() const noexcept {return const_iterator{this, 0};}
+    const_iterator cend() const noexcept {return end();}
+
+    /** put-to operator */
+    friend
+    std::ostream& operator<<(std::ostream& os, const frozen_bst& x) {
+        if (x.empty()) {
+            os << "WARNING: empty tree";
+            return os;
+        }
+        for (auto& key : x) {
+            os << key << " ";
+        }
+        os << '\n';
+        return os;
+    }
+};
+
+
+// definition of function save - out of the class
+/** function save
+ * header, keys from index 0 (not used) to n, padding to 64 bytes, values from index 0 to n */
+template<typename k_t, typename v_t, typename OP>
+void frozen_bst<k_t, v_t, OP>::save(const std::string& path) const {
+    static_assert(serializer<k_t>::flat && serializer<v_t>::flat, "the flat layout needs flat serializers");
+    auto h = _make_header<k_t, v_t>(_size, true);
+    auto os = _open_output(path);
+    os.write(reinterpret_cast<const char*>(&h), sizeof h);
+    k_t unused_key{};
+    v_t unused_value{};
+    os.write(reinterpret_cast<const char*>(_size ? _keys : &unused_key), static_cast<std::streamsize>((_size + 1) * sizeof(k_t)));
+    _pad(os, h.keys_offset + (_size + 1) * sizeof(k_t), h.values_offset);
+    os.write(reinterpret_cast<const char*>(_size ? _values : &unused_value), static_cast<std::streamsize>((_size + 1) * sizeof(v_t)));
+    _close_output(os, path);
+}
+
+
+// definition of function load - out of the class
+/** function load
+ * the arrays are read in place from the mapping, which is owned by the snapshot */
+template<typename k_t, typename v_t, typename OP>
+frozen_bst<k_t, v_t, OP> frozen_bst<k_t, v_t, OP>::load(const std::string& path, OP op) {
+    static_assert(serializer<k_t>::flat && serializer<v_t>::flat, "the flat layout needs flat serializers");
+    static_assert(alignof(k_t) <= 64 && alignof(v_t) <= 64, "the arrays of a file are aligned to 64 bytes");
+    auto mapping = std::make_shared<_file_mapping>(path);
+    auto h = mapping->header<k_t, v_t>(path);
+    if (!h.flat) {
+        throw std::runtime_error(path + " has no flat layout");
+    }
+    frozen_bst x;
+    x.comp = op;
+    x._keys = reinterpret_cast<const k_t*>(mapping->data() + h.keys_offset);
+    x._values = reinterpret_cast<const v_t*>(mapping->data() + h.values_offset);
+    x._size = static_cast<std::size_t>(h.count);
+    x._storage = std::move(mapping);
+    return x;
+}
+
+#endif
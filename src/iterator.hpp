@@ -1,7 +1,10 @@
 #ifndef _bst_iterator
 #define _bst_iterator
 #include "node.hpp"
+#include "balance.hpp"
+#include "traits.hpp"
 
+#include <cstddef>      //std::ptrdiff_t
 #include <iterator>
 #include <utility>
 #include <memory>
@@ -9,28 +12,54 @@
 /**
  * *********  Class iterator  **********
  * 
- * template class for forwarding iterator 
- * it is used to traverse the binary search tree in order
- * every instance of the iterator is a raw pointer to a node
+ * template class for bidirectional iterator 
+ * it is used to traverse the binary search tree in order, forward and backward
+ * with the order_statistics policy it is a random access iterator: the nodes know the size of their
+ * subtree, so jumps and differences (std::next, std::distance) cost O(height) instead of O(n)
+ * every instance of the iterator is a raw pointer to a node, plus a pointer to the member
+ * of the tree holding its last node, so that end() can be decremented
+ * (iterators are not invalidated by insertions and erasures of other nodes,
+ * but the end() of a tree which has been moved cannot be decremented any more)
  * it is a subclass of class bst
  * 
- * @param o --> template for the iterator
- * @param k_t --> template for key type
- * @param v_t --> template for value type
+ * @param O --> template for the iterator (key type, const or not)
+ * @param N --> template for the node type of the tree
  */
 
-template<typename O, typename k_t, typename v_t>
+template<typename O, typename N>
 class _iterator{
     
-    using node = _node<k_t,v_t>;
-    node* current;    //raw pointer to the node
+    using node = N;
+    using v_t = typename node::mapped_type;
+    node* current{nullptr};           //raw pointer to the node
+    node* const* last{nullptr};       //raw pointer to the last node of the tree, used by --end()
+
+    /** true if the nodes store the size of their subtree (order_statistics) */
+    static constexpr bool _counted = _stores_count<node>::value;
+
+    /** auxiliary function _root: climbs from the node (or from the last node, for end()) to the root */
+    node* _root() const noexcept {
+        node* n = current ? current : *last;
+        while (n && n->_parent) {
+            n = n->_parent;
+        }
+        return n;
+    }
+
+    /** auxiliary function _index
+     * @return returns the position of the node in order, the size of the tree for end() */
+    std::ptrdiff_t _index() const noexcept {
+        static_assert(_counted, "random access needs the order_statistics policy");
+        return static_cast<std::ptrdiff_t>(current ? _node_index(current) : _subtree_count(_root()));
+    }
     
  public:
     using value_type = O;         
     using reference = value_type &;
     using pointer = value_type *;
     using difference_type = std::ptrdiff_t;
-    using iterator_category = std::forward_iterator_tag;
+    using iterator_category = std::conditional_t<_counted, std::random_access_iterator_tag,
+                                                 std::bidirectional_iterator_tag>;
     
      /**
       * function curr_node
@@ -43,11 +72,11 @@ class _iterator{
 
     /**
      * custom ctor
-     * input arg --> a pointer to node 
+     * input arg --> a pointer to node and the address of the pointer to the last node of its tree
      * output --> an iterator pointing to x
      * no implicit conversion form node* to iterator
      */
-    explicit _iterator(node* x) noexcept : current{x} {}
+    explicit _iterator(node* x, node* const* last_node = nullptr) noexcept : current{x}, last{last_node} {}
 
     /** default dtor */
     ~_iterator() noexcept = default;
@@ -88,6 +117,44 @@ class _iterator{
         return tmp;
     }
 
+    /**
+     * pre-decrement operator
+     * returns an iterator which points to the previous node with respect to ordering rule of bst;
+     * decrementing end() gives the last node
+     */
+    _iterator& operator--() {
+        if (!current){
+            current = *last;                          // from end() to the right most node
+        }
+        else if (current->_left){
+            current = current->_left.get();           //move current to the left child
+            while(current->_right){
+                current = current->_right.get();      //and then to the right as much as possible
+            }
+        }
+        /** if current doesnt have left child, we visit back the parent node
+        * until we come from a right child*/
+        else{
+            auto tmp = current->_parent;
+            while(tmp && current != tmp->_right.get()) {
+                current = tmp;
+                tmp = tmp->_parent;
+            }
+            current = tmp;
+        }
+        return *this;
+    }
+
+    /**
+     * post-decrement operator
+     * returns an iterator which points to the previous node with respect to ordering rule of bst
+     */
+     _iterator operator--(int) {
+        auto tmp{*this};
+        --(*this);
+        return tmp;
+    }
+
     /**
      * arrow operator->
      * returns a pointer to the key of the node the iterator points to 
@@ -113,6 +180,42 @@ class _iterator{
       */
      const v_t& value () const {return current->_pair.second;}
 
+     /**
+      * operator += (order_statistics)
+      * moves the iterator by d positions, to end() for the position after the last node, in O(height)
+      */
+     _iterator& operator+=(difference_type d) noexcept {
+        auto i = _index() + d;
+        current = _node_select(_root(), static_cast<std::size_t>(i));
+        return *this;
+     }
+
+     /** operator -= (order_statistics) */
+     _iterator& operator-=(difference_type d) noexcept {return *this += -d;}
+
+     /** operator + (order_statistics) */
+     friend _iterator operator+(_iterator a, difference_type d) noexcept {return a += d;}
+
+     /** operator + (order_statistics) */
+     friend _iterator operator+(difference_type d, _iterator a) noexcept {return a += d;}
+
+     /** operator - (order_statistics) */
+     friend _iterator operator-(_iterator a, difference_type d) noexcept {return a -= d;}
+
+     /** operator - (order_statistics)
+      * @return returns the number of positions from b to a, in O(height) */
+     friend difference_type operator-(const _iterator& a, const _iterator& b) noexcept {return a._index() - b._index();}
+
+     /** subscripting operator (order_statistics)
+      * @return returns the key d positions after the iterator */
+     reference operator[](difference_type d) const noexcept {return *(*this + d);}
+
+     /** operators <, >, <=, >= (order_statistics): compare the positions */
+     friend bool operator<(const _iterator& a, const _iterator& b) noexcept {return a - b < 0;}
+     friend bool operator>(const _iterator& a, const _iterator& b) noexcept {return b < a;}
+     friend bool operator<=(const _iterator& a, const _iterator& b) noexcept {return !(b < a);}
+     friend bool operator>=(const _iterator& a, const _iterator& b) noexcept {return !(a < b);}
+
      /** operator == */ 
      friend 
      bool operator==(const _iterator &a, const _iterator &b) noexcept{
@@ -125,4 +228,33 @@ class _iterator{
 
 };
 
+
+/**
+ * *********  Class range  **********
+ * 
+ * a pair of iterators [first, last) usable in a range-based for loop
+ * returned by the function range of bst
+ * 
+ * @param I --> template for the iterator type
+ */
+template<typename I>
+class _range{
+
+    I first;
+    I last;
+
+ public:
+    /** custom ctor */
+    _range(I begin, I end) noexcept : first{begin}, last{end} {}
+
+    /** function begin */
+    I begin() const noexcept {return first;}
+
+    /** function end */
+    I end() const noexcept {return last;}
+
+    /** function empty */
+    bool empty() const noexcept {return first == last;}
+};
+
 #endif
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <utility>  //std::move , std::pair
 #include <memory>  //std::unique_ptr
+#include <tuple>  //std::piecewise_construct
 
 /** 
  * ********* Class node *********
@@ -12,20 +13,27 @@
  * each node has its own associated pair of key and value
  * we define a unique pointer to each of the children of a parent node (left child and right child)
  * and a raw pointer to the parent node itself
+ * nodes are created by the pool of the tree (see allocator.hpp), the copy of a subtree is done by the tree
  * k_t --> template for key type
  * v_t --> template for value type
+ * M   --> template for the extra data of the balancing policy (e.g. the height for AVL trees)
+ * A   --> template for the allocator policy, which gives the deleter of the unique pointers
 */
-template<typename k_t, typename v_t>
-struct _node{
+template<typename k_t, typename v_t, typename M, typename A>
+struct _node : M {
+
+    using key_type = k_t;
+    using mapped_type = v_t;
+    using node_ptr = std::unique_ptr<_node, typename A::template deleter<_node>>;
     
     /** pair of key and value */
     std::pair<k_t,v_t> _pair;    
     /** unique pointer to right child */
-    std::unique_ptr<_node> _right;
+    node_ptr _right;
     /** unique pointer to left child */
-    std::unique_ptr<_node> _left;
-    /** raw pointer to parent node */
-    _node* _parent;
+    node_ptr _left;
+    /** raw pointer to parent node (nullptr for the root) */
+    _node* _parent{nullptr};
 
 
     /** default constructor */
@@ -43,26 +51,12 @@ struct _node{
      */
     explicit _node (std::pair<k_t, v_t>&& pair) noexcept: _pair(std::move(pair)) {}
     /**
-     * custom ctor
-     * to construct a new left or right child for a parent node
-     * @param x unique pointer to the node to copy from (we use it for copy semantics)
-     * @param parent raw pointer to the parent node
+     * custom ctor - piecewise
+     * the key and the value are constructed in place from two tuples of arguments
      */
-   explicit _node (const std::unique_ptr<_node>& x, _node* parent) noexcept :  //explicit because the argument raw pointer parent 
-            _pair{x->_pair}, _parent{parent}                                                                  // is "this"
-            {    
-            //right
-            if (x->_right){        // if x is a right child
-                _right.reset(new _node{x->_right, this});  //this node is the parent of its child
-            }
-            else{_right.reset();}   //if it is not a right child, _right points to nullptr
-            // left
-            if (x->_left){        //if x is a left child
-                _left.reset(new _node{x->_left, this});
-            }
-            else{_left.reset();}   //if it is not a left child, _left points to nullptr
-
-        }
+    template<typename K, typename V>
+    _node (std::piecewise_construct_t, K&& key_args, V&& value_args) :
+        _pair(std::piecewise_construct, std::forward<K>(key_args), std::forward<V>(value_args)) {}
 
 
     /** default destructor */
@@ -0,0 +1,55 @@
+#ifndef _bst_node_handle
+#define _bst_node_handle
+
+#include <utility>  //std::move
+
+template<typename k_t, typename v_t, typename OP, typename BP, typename AP>
+class bst;
+
+/**
+ * ********* Class _node_handle *********
+ *
+ * owner of a node taken out of a tree by bst::extract (bst::node_type), to be linked again by
+ * bst::insert in the same tree or in another tree of the same type: the node is not freed
+ * and its pair is neither copied nor moved. While the node is in no tree its key can be changed
+ * through key(); a handle that is not inserted destroys the node
+ * N --> template for the node type
+ */
+template<typename N>
+class _node_handle {
+
+    template<typename, typename, typename, typename, typename>
+    friend class bst;
+
+    typename N::node_ptr _ptr;
+
+    explicit _node_handle(typename N::node_ptr p) noexcept : _ptr{std::move(p)} {}
+
+ public:
+    using key_type = typename N::key_type;
+    using mapped_type = typename N::mapped_type;
+
+    /** default ctor: an empty handle */
+    _node_handle() noexcept = default;
+
+    _node_handle(_node_handle&&) noexcept = default;
+    _node_handle& operator=(_node_handle&&) noexcept = default;
+
+    /** function empty
+     * @return returns true if the handle owns no node (e.g. extract did not find the key) */
+    bool empty() const noexcept {return !_ptr;}
+
+    explicit operator bool() const noexcept {return static_cast<bool>(_ptr);}
+
+    /** function key
+     * the handle must not be empty
+     * @return returns a reference to the key, which may be modified before insert */
+    key_type& key() const noexcept {return _ptr->_pair.first;}
+
+    /** function mapped
+     * the handle must not be empty
+     * @return returns a reference to the value */
+    mapped_type& mapped() const noexcept {return _ptr->_pair.second;}
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef _bst_parallel
+#define _bst_parallel
+
+#include <cstddef>     //std::size_t
+#include <atomic>
+#include <exception>   //std::exception_ptr
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>   //std::min
+
+/**
+ * ********* Parallel tasks *********
+ *
+ * the parallel operations of bst split the tree (or the sorted range) at its top levels into
+ * independent subtrees, one task each, and run the tasks on a few std::threads
+ * there are a few times more tasks than threads, so that uneven subtrees are spread among the threads
+ */
+
+
+/** function hardware_threads
+ * @return returns the number of hardware threads, at least 1 */
+inline std::size_t hardware_threads() noexcept {
+    std::size_t n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+/** _split_levels: number of top levels to cut so that there are at least 4 tasks per thread */
+inline std::size_t _split_levels(std::size_t threads) noexcept {
+    std::size_t levels = 0;
+    while ((std::size_t{1} << levels) < 4 * threads) {
+        ++levels;
+    }
+    return levels;
+}
+
+/**
+ * function _parallel_for
+ * runs task(i) for every i in [0, tasks) on at most `threads` threads, the calling one included;
+ * the threads take the next task from a shared counter
+ * if a thread cannot be started its tasks are run by the others, so no task is ever lost;
+ * the first exception thrown by a task is rethrown once all the threads are joined
+ */
+template<typename F>
+void _parallel_for(std::size_t threads, std::size_t tasks, F&& task) {
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_lock;
+
+    auto work = [&]() noexcept {
+        for (std::size_t i = next.fetch_add(1); i < tasks; i = next.fetch_add(1)) {
+            try {
+                task(i);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock{error_lock};
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    try {
+        std::size_t extra = std::min(threads, tasks);
+        workers.reserve(extra ? extra - 1 : 0);
+        for (std::size_t i = 1; i < extra; ++i) {
+            workers.emplace_back(work);
+        }
+    }
+    catch (...) {}                 // fewer threads: the ones running share all the tasks
+    work();
+    for (auto& w : workers) {
+        w.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif
@@ -0,0 +1,401 @@
+#ifndef _bst_persistent
+#define _bst_persistent
+
+#include <iostream>
+#include <iterator>
+#include <memory>      //std::shared_ptr
+#include <utility>
+#include <algorithm>   //std::max
+#include <functional>  //std::less
+
+/**
+ * ********* Class persistent node *********
+ *
+ * node of a persistent_bst: immutable once built, shared by all the versions of the tree that contain it
+ * the children are shared pointers, there is no parent pointer (a node has many parents)
+ */
+template<typename k_t, typename v_t>
+struct _pnode {
+
+    using key_type = k_t;
+    using mapped_type = v_t;
+    using node_ptr = std::shared_ptr<const _pnode>;
+
+    /** pair of key and value */
+    std::pair<k_t, v_t> _pair;
+    /** shared pointer to left child */
+    node_ptr _left;
+    /** shared pointer to right child */
+    node_ptr _right;
+    /** height of the subtree rooted at the node (a leaf has height 1) */
+    int _height;
+    /** number of nodes of the subtree rooted at the node: the size of a version is read from its root */
+    std::size_t _count;
+
+    /** custom ctor: the height and the count follow from the children */
+    template<typename P>
+    _pnode(P&& pair, node_ptr left, node_ptr right) :
+        _pair(std::forward<P>(pair)), _left{std::move(left)}, _right{std::move(right)},
+        _height{1 + std::max(_left ? _left->_height : 0, _right ? _right->_height : 0)},
+        _count{1 + (_left ? _left->_count : 0) + (_right ? _right->_count : 0)} {}
+};
+
+
+/**
+ * *********  Class persistent iterator  **********
+ *
+ * forward iterator over the keys of a persistent_bst, in order
+ * the nodes have no parent pointer, so the iterator keeps the stack of the nodes still to be visited
+ * (the current node on top), in a fixed array: the height of an AVL tree with less than 2^44 nodes
+ * is less than 64, so iterating and find never allocate. The iterator stays valid as long as
+ * the version of the tree it comes from, whatever happens to the other versions
+ *
+ * @param N --> template for the node type
+ */
+template<typename N>
+class _persistent_iterator{
+
+    template<typename, typename, typename>
+    friend class persistent_bst;
+
+    using node = N;
+    using v_t = typename node::mapped_type;
+    static constexpr int _capacity = 64;
+    const node* stack[_capacity];       //the current node and its ancestors not visited yet
+    int depth{0};
+
+    void _push(const node* n) noexcept {stack[depth++] = n;}
+
+    /** pushes n and its left descendants */
+    void _push_left(const node* n) noexcept {
+        for (; n; n = n->_left.get()) {
+            _push(n);
+        }
+    }
+
+ public:
+    using value_type = const typename node::key_type;
+    using reference = value_type &;
+    using pointer = value_type *;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    /** default ctor: end() */
+    _persistent_iterator() noexcept = default;
+
+    /** custom ctor: first key of the subtree rooted at root */
+    explicit _persistent_iterator(const node* root) noexcept {_push_left(root);}
+
+    /** pre-increment operator: the next node is the leftmost of the right subtree, or the next on the stack */
+    _persistent_iterator& operator++() noexcept {
+        const node* n = stack[--depth];
+        _push_left(n->_right.get());
+        return *this;
+    }
+
+    /** post-increment operator */
+    _persistent_iterator operator++(int) {
+        auto tmp{*this};
+        ++(*this);
+        return tmp;
+    }
+
+    /** arrow operator-> */
+    pointer operator->() const noexcept {return &**this;}
+
+    /** dereference operator*: returns the key of the node */
+    reference operator*() const noexcept {return stack[depth - 1]->_pair.first;}
+
+    /** function value: returns the associated value of the node */
+    const v_t& value() const noexcept {return stack[depth - 1]->_pair.second;}
+
+    /** operator == */
+    friend
+    bool operator==(const _persistent_iterator& a, const _persistent_iterator& b) noexcept {
+        return !a.depth ? !b.depth : b.depth && a.stack[a.depth - 1] == b.stack[b.depth - 1];
+    }
+
+    /** operator != */
+    friend
+    bool operator!=(const _persistent_iterator& a, const _persistent_iterator& b) noexcept {return !(a == b);}
+};
+
+
+/**
+ * ********* Class persistent_bst **********
+ *
+ * AVL tree with path copying: an update never modifies a node, it builds new copies of the O(log n)
+ * nodes on the path from the root to the modified one and shares all the other subtrees
+ * therefore copying a tree is O(1) (the root is shared) and every copy is an independent version:
+ * snapshot() gives a consistent view that is not affected by the later updates
+ * a node is freed when the last version containing it is gone
+ * a single version must not be modified by several threads at once, but different versions
+ * can be read and updated by different threads; while one thread updates a tree, other threads
+ * can take snapshot() of it: the updates publish the new root with std::atomic_store and snapshot()
+ * reads it with std::atomic_load (the other functions read the root plainly and belong to the
+ * writer, or to a snapshot)
+ *
+ * @param k_t --> template for key type
+ * @param v_t --> template for value type
+ * @param OP  --> template for Operator Comparison (OP) which is std::less<k_t>
+ */
+template <typename k_t, typename v_t, typename OP = std::less<k_t>>
+class persistent_bst{
+
+    using node = _pnode<k_t, v_t>;
+    using node_ptr = typename node::node_ptr;
+
+    /** private members of the class */
+    node_ptr _root;                  //written with std::atomic_store, the size is in the root
+    OP comp;                         //comparison
+
+    /** height of a subtree, 0 for an empty one */
+    static int _height(const node_ptr& n) noexcept {return n ? n->_height : 0;}
+
+    static node_ptr _make(const std::pair<k_t, v_t>& pair, node_ptr left, node_ptr right) {
+        return std::make_shared<const node>(pair, std::move(left), std::move(right));
+    }
+
+    static node_ptr _balance(const std::pair<k_t, v_t>& pair, node_ptr left, node_ptr right);
+    template<typename P>
+    node_ptr _insert(const node_ptr& n, P&& x, bool assign, bool& inserted) const;
+    node_ptr _erase(const node_ptr& n, const k_t& x, bool& erased) const;
+    static node_ptr _erase_min(const node_ptr& n, const node*& min);
+
+    /** custom ctor: the version rooted at root */
+    persistent_bst(node_ptr root, const OP& op) noexcept : _root{std::move(root)}, comp{op} {}
+
+ public:
+    using key_type = k_t;
+    using mapped_type = v_t;
+    using const_iterator = _persistent_iterator<node>;
+    using iterator = const_iterator;
+
+    /** default ctor */
+    persistent_bst() noexcept = default;
+
+    /** copy ctor - O(1): the two trees share all their nodes */
+    persistent_bst(const persistent_bst&) noexcept = default;
+    persistent_bst& operator=(const persistent_bst&) noexcept = default;
+    persistent_bst(persistent_bst&& x) noexcept = default;
+    persistent_bst& operator=(persistent_bst&& x) noexcept = default;
+
+    /** default dtor: the nodes not shared with other versions are freed */
+    ~persistent_bst() noexcept = default;
+
+    /** function snapshot
+     * can run while another thread updates the tree (the root is read with std::atomic_load)
+     * @return returns a version of the tree frozen at this point, in O(1) */
+    persistent_bst snapshot() const noexcept {return persistent_bst{std::atomic_load(&_root), comp};}
+
+    /** function insert
+     * inserts the pair if its key is not present, copying the path from the root
+     * @return returns true if the pair has been inserted */
+    bool insert(const std::pair<k_t, v_t>& x) {
+        bool inserted = false;
+        auto root = _insert(_root, x, false, inserted);    // the tree changes only if no allocation fails
+        std::atomic_store(&_root, std::move(root));
+        return inserted;
+    }
+
+    /** function insert - r-value */
+    bool insert(std::pair<k_t, v_t>&& x) {
+        bool inserted = false;
+        auto root = _insert(_root, std::move(x), false, inserted);
+        std::atomic_store(&_root, std::move(root));
+        return inserted;
+    }
+
+    /** function insert_or_assign
+     * inserts the pair, or replaces the value of its key (in a new copy of the node)
+     * @return returns true if the pair has been inserted, false if assigned */
+    bool insert_or_assign(const k_t& key, const v_t& value) {
+        bool inserted = false;
+        auto root = _insert(_root, std::pair<k_t, v_t>{key, value}, true, inserted);
+        std::atomic_store(&_root, std::move(root));
+        return inserted;
+    }
+
+    /** function emplace
+     * @return returns true if the pair has been inserted */
+    template<class... Types>
+    bool emplace(Types&&... args) {return insert(std::pair<k_t, v_t>{std::forward<Types>(args)...});}
+
+    /** function erase
+     * removes the node with key x, copying the path from the root
+     * @return returns true if a node has been removed */
+    bool erase(const k_t& x) {
+        bool erased = false;
+        auto root = _erase(_root, x, erased);
+        std::atomic_store(&_root, std::move(root));
+        return erased;
+    }
+
+    /** function find
+     * @return returns an iterator to the key or end() */
+    const_iterator find(const k_t& x) const noexcept {
+        const_iterator it;                          // the nodes where the search goes left are visited later
+        for (const node* tmp = _root.get(); tmp;) {
+            if (comp(x, tmp->_pair.first)) {
+                it._push(tmp);
+                tmp = tmp->_left.get();
+            }
+            else if (comp(tmp->_pair.first, x)) {
+                tmp = tmp->_right.get();
+            }
+            else {
+                it._push(tmp);
+                return it;
+            }
+        }
+        return end();
+    }
+
+    /** function contains
+     * @return returns true if there is a node with key x */
+    bool contains(const k_t& x) const noexcept {
+        for (const node* tmp = _root.get(); tmp;) {
+            if (comp(x, tmp->_pair.first)) {
+                tmp = tmp->_left.get();
+            }
+            else if (comp(tmp->_pair.first, x)) {
+                tmp = tmp->_right.get();
+            }
+            else {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** function clear: releases the nodes of this version */
+    void clear() noexcept {std::atomic_store(&_root, node_ptr{});}
+
+    /** function size */
+    std::size_t size() const noexcept {return _root ? _root->_count : 0;}
+
+    /** function height */
+    int height() const noexcept {return _height(_root);}
+
+    /** function begin */
+    const_iterator begin() const noexcept {return const_iterator{_root.get()};}
+    const_iterator cbegin() const {return begin();}
+
+    /** function end */
+    const_iterator end() const noexcept {return const_iterator{};}
+    const_iterator cend() const noexcept {return end();}
+
+    /** put-to operator */
+    friend
+    std::ostream& operator<<(std::ostream& os, const persistent_bst& x) {
+        if (!x._root) {
+            os << "WARNING: empty tree";
+            return os;
+        }
+        for (auto& key : x) {
+            os << key << " ";
+        }
+        os << '\n';
+        return os;
+    }
+};
+
+
+// definition of function _balance - out of the class
+/** function _balance
+ * builds a node with the given pair and children, restoring the AVL property with new nodes
+ * (a single or double rotation) if the heights of the children differ by two
+ * @return returns the root of the new subtree */
+template<typename k_t, typename v_t, typename OP>
+typename persistent_bst<k_t, v_t, OP>::node_ptr
+persistent_bst<k_t, v_t, OP>::_balance(const std::pair<k_t, v_t>& pair, node_ptr left, node_ptr right) {
+    int diff = _height(left) - _height(right);
+    if (diff > 1) {                                             // left heavy
+        if (_height(left->_left) >= _height(left->_right)) {    // left-left case
+            return _make(left->_pair, left->_left, _make(pair, left->_right, std::move(right)));
+        }
+        const node* lr = left->_right.get();                    // left-right case
+        return _make(lr->_pair, _make(left->_pair, left->_left, lr->_left), _make(pair, lr->_right, std::move(right)));
+    }
+    if (diff < -1) {                                            // right heavy
+        if (_height(right->_right) >= _height(right->_left)) {  // right-right case
+            return _make(right->_pair, _make(pair, std::move(left), right->_left), right->_right);
+        }
+        const node* rl = right->_left.get();                    // right-left case
+        return _make(rl->_pair, _make(pair, std::move(left), rl->_left), _make(right->_pair, rl->_right, right->_right));
+    }
+    return _make(pair, std::move(left), std::move(right));
+}
+
+
+// definition of function _insert - out of the class
+/** function _insert
+ * inserts x in the subtree rooted at n (or assigns its value, if assign)
+ * @return returns the new root of the subtree, n itself if nothing has changed */
+template<typename k_t, typename v_t, typename OP>
+template<typename P>
+typename persistent_bst<k_t, v_t, OP>::node_ptr
+persistent_bst<k_t, v_t, OP>::_insert(const node_ptr& n, P&& x, bool assign, bool& inserted) const {
+    if (!n) {
+        inserted = true;
+        return std::make_shared<const node>(std::forward<P>(x), nullptr, nullptr);
+    }
+    if (comp(x.first, n->_pair.first)) {
+        auto left = _insert(n->_left, std::forward<P>(x), assign, inserted);
+        return left == n->_left ? n : _balance(n->_pair, std::move(left), n->_right);
+    }
+    if (comp(n->_pair.first, x.first)) {
+        auto right = _insert(n->_right, std::forward<P>(x), assign, inserted);
+        return right == n->_right ? n : _balance(n->_pair, n->_left, std::move(right));
+    }
+    if (!assign) {                                      // the key is present: the tree does not change
+        return n;
+    }
+    return std::make_shared<const node>(std::forward<P>(x), n->_left, n->_right);
+}
+
+
+// definition of function _erase_min - out of the class
+/** function _erase_min
+ * removes the smallest node of the subtree rooted at n (not empty), which is returned in min
+ * @return returns the new root of the subtree */
+template<typename k_t, typename v_t, typename OP>
+typename persistent_bst<k_t, v_t, OP>::node_ptr
+persistent_bst<k_t, v_t, OP>::_erase_min(const node_ptr& n, const node*& min) {
+    if (!n->_left) {
+        min = n.get();
+        return n->_right;
+    }
+    auto left = _erase_min(n->_left, min);
+    return _balance(n->_pair, std::move(left), n->_right);
+}
+
+
+// definition of function _erase - out of the class
+/** function _erase
+ * removes the node with key x from the subtree rooted at n
+ * @return returns the new root of the subtree, n itself if x is not present */
+template<typename k_t, typename v_t, typename OP>
+typename persistent_bst<k_t, v_t, OP>::node_ptr
+persistent_bst<k_t, v_t, OP>::_erase(const node_ptr& n, const k_t& x, bool& erased) const {
+    if (!n) {
+        return n;
+    }
+    if (comp(x, n->_pair.first)) {
+        auto left = _erase(n->_left, x, erased);
+        return erased ? _balance(n->_pair, std::move(left), n->_right) : n;
+    }
+    if (comp(n->_pair.first, x)) {
+        auto right = _erase(n->_right, x, erased);
+        return erased ? _balance(n->_pair, n->_left, std::move(right)) : n;
+    }
+    erased = true;
+    if (!n->_left || !n->_right) {
+        return n->_left ? n->_left : n->_right;
+    }
+    const node* successor = nullptr;                    // the successor takes the place of n
+    auto right = _erase_min(n->_right, successor);
+    return _balance(successor->_pair, n->_left, std::move(right));
+}
+
+#endif
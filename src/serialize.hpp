@@ -0,0 +1,255 @@
+#ifndef _bst_serialize
+#define _bst_serialize
+
+#include <cstddef>      //std::size_t
+#include <cstdint>      //std::uint64_t
+#include <cstring>      //std::memcpy
+#include <string>
+#include <ostream>
+#include <fstream>
+#include <stdexcept>    //std::runtime_error
+#include <type_traits>
+#include <algorithm>    //std::min
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _BST_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define _BST_MMAP 0
+#include <new>          //std::align_val_t
+#endif
+
+/**
+ * ********* Binary files of trees *********
+ *
+ * a file starts with a header of 64 bytes, followed by one of two layouts:
+ * - flat: the keys in Eytzinger order (see frozen.hpp) and the values in a parallel array, stored as
+ *   raw bytes and aligned to 64 bytes, so that frozen_bst::load can map the file and search it in place
+ * - records: the pairs in key order, one after the other, written by serializer<k_t> and serializer<v_t>
+ * the flat layout is used when both serializers are flat (trivially copyable types, by default)
+ * the files are meant for machines with the same byte order (the sizes of the types are checked)
+ */
+
+
+/** error thrown when a file or a stream of records ends in the middle of a record */
+struct truncated_error : std::runtime_error {
+    truncated_error() : std::runtime_error{"truncated tree file"} {}
+};
+
+/** _need: throws truncated_error if fewer than n bytes are left in [p, end) */
+inline void _need(const char* p, const char* end, std::size_t n) {
+    if (static_cast<std::size_t>(end - p) < n) {
+        throw truncated_error{};
+    }
+}
+
+/**
+ * serializer<T>
+ * hook for the types stored in the files: specialize it for the types that are not trivially copyable
+ * flat  --> true if T is stored as its raw bytes (only then the file can be memory-mapped)
+ * write --> appends x to out, a std::ostream or any object with write(const char*, std::streamsize)
+ * read  --> reads a value at p and advances p, never past end (else it throws truncated_error)
+ */
+template<typename T>
+struct serializer {
+    static_assert(std::is_trivially_copyable_v<T>, "specialize serializer<T> for a type that is not trivially copyable");
+
+    static constexpr bool flat = true;
+
+    template<typename Out>
+    static void write(Out& out, const T& x) {out.write(reinterpret_cast<const char*>(&x), sizeof(T));}
+
+    static T read(const char*& p, const char* end) {
+        _need(p, end, sizeof(T));
+        T x;
+        std::memcpy(&x, p, sizeof(T));
+        p += sizeof(T);
+        return x;
+    }
+};
+
+/** serializer<std::string>: the length (8 bytes), then the characters */
+template<>
+struct serializer<std::string> {
+
+    static constexpr bool flat = false;
+
+    template<typename Out>
+    static void write(Out& out, const std::string& x) {
+        serializer<std::uint64_t>::write(out, x.size());
+        out.write(x.data(), static_cast<std::streamsize>(x.size()));
+    }
+
+    static std::string read(const char*& p, const char* end) {
+        auto n = static_cast<std::size_t>(serializer<std::uint64_t>::read(p, end));
+        _need(p, end, n);
+        std::string x(p, n);
+        p += n;
+        return x;
+    }
+};
+
+
+/** header at the beginning of every file */
+struct _file_header {
+    char magic[8];                  // "bst-tree"
+    std::uint32_t version;
+    std::uint32_t flat;             // 1: flat layout, 0: records
+    std::uint64_t count;            // number of pairs
+    std::uint64_t key_size;         // sizeof(k_t) and sizeof(v_t) (flat layout)
+    std::uint64_t value_size;
+    std::uint64_t keys_offset;      // offsets of the arrays from the beginning of the file (flat layout)
+    std::uint64_t values_offset;
+    std::uint64_t reserved;
+};
+static_assert(sizeof(_file_header) == 64, "the header is one cache line");
+
+inline constexpr char _file_magic[8] = {'b', 's', 't', '-', 't', 'r', 'e', 'e'};
+inline constexpr std::uint32_t _file_version = 1;
+
+/** _align64: the first multiple of 64 not smaller than x */
+inline std::uint64_t _align64(std::uint64_t x) noexcept {return (x + 63) / 64 * 64;}
+
+/** _make_header: header of a file of n pairs; the offsets are computed for the flat layout */
+template<typename k_t, typename v_t>
+_file_header _make_header(std::size_t n, bool flat) noexcept {
+    _file_header h{};
+    std::memcpy(h.magic, _file_magic, sizeof h.magic);
+    h.version = _file_version;
+    h.flat = flat ? 1 : 0;
+    h.count = n;
+    if (flat) {
+        h.key_size = sizeof(k_t);
+        h.value_size = sizeof(v_t);
+        h.keys_offset = sizeof(_file_header);
+        h.values_offset = _align64(h.keys_offset + (n + 1) * sizeof(k_t));    // Eytzinger arrays: n + 1 slots
+    }
+    return h;
+}
+
+/** _open_output: opens a file for writing, throws std::runtime_error if it cannot */
+inline std::ofstream _open_output(const std::string& path) {
+    std::ofstream os{path, std::ios::binary | std::ios::trunc};
+    if (!os) {
+        throw std::runtime_error("cannot open " + path + " for writing");
+    }
+    return os;
+}
+
+/** _close_output: flushes and closes the file, throws std::runtime_error if any write failed */
+inline void _close_output(std::ofstream& os, const std::string& path) {
+    os.close();
+    if (!os) {
+        throw std::runtime_error("cannot write " + path);
+    }
+}
+
+/** _pad: writes zeros up to the offset `to` of the file */
+inline void _pad(std::ostream& os, std::uint64_t from, std::uint64_t to) {
+    static const char zeros[64] = {};
+    while (from < to) {
+        auto n = std::min<std::uint64_t>(to - from, sizeof zeros);
+        os.write(zeros, static_cast<std::streamsize>(n));
+        from += n;
+    }
+}
+
+
+/**
+ * ********* Class _file_mapping *********
+ *
+ * a whole file mapped read-only in memory (mmap), or read into a 64-byte aligned buffer
+ * where mmap is not available; the data is at least 64-byte aligned in both cases
+ */
+class _file_mapping {
+    const char* _data{nullptr};
+    std::size_t _size{0};
+
+ public:
+    /** custom ctor: maps the file, throws std::runtime_error if it cannot */
+    explicit _file_mapping(const std::string& path);
+
+    /** dtor: unmaps the file */
+    ~_file_mapping();
+
+    _file_mapping(const _file_mapping&) = delete;
+    _file_mapping& operator=(const _file_mapping&) = delete;
+
+    const char* data() const noexcept {return _data;}
+    std::size_t size() const noexcept {return _size;}
+
+    /** function header
+     * checks the header of the file (and, for the flat layout, the sizes and the bounds of the arrays)
+     * @return returns the header */
+    template<typename k_t, typename v_t>
+    _file_header header(const std::string& path) const {
+        _file_header h;
+        const char* p = _data;
+        _need(p, _data + _size, sizeof h);
+        std::memcpy(&h, p, sizeof h);
+        if (std::memcmp(h.magic, _file_magic, sizeof h.magic) != 0 || h.version != _file_version) {
+            throw std::runtime_error(path + " is not a tree file");
+        }
+        if (h.flat) {
+            if (h.key_size != sizeof(k_t) || h.value_size != sizeof(v_t)) {
+                throw std::runtime_error(path + " was saved with different key or value types");
+            }
+            auto expected = _make_header<k_t, v_t>(h.count, true);
+            if (h.count >= _size || h.keys_offset != expected.keys_offset || h.values_offset != expected.values_offset
+                || _size < h.values_offset + (h.count + 1) * sizeof(v_t)) {
+                throw truncated_error{};
+            }
+        }
+        return h;
+    }
+};
+
+
+// definition of the ctor of _file_mapping - out of the class
+inline _file_mapping::_file_mapping(const std::string& path) {
+#if _BST_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("cannot map " + path);
+    }
+    void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);                                       // the mapping keeps the file
+    if (p == MAP_FAILED) {
+        throw std::runtime_error("cannot map " + path);
+    }
+    _data = static_cast<const char*>(p);
+    _size = static_cast<std::size_t>(st.st_size);
+#else
+    std::ifstream is{path, std::ios::binary | std::ios::ate};
+    if (!is) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    _size = static_cast<std::size_t>(is.tellg());
+    char* buffer = static_cast<char*>(::operator new(_size ? _size : 1, std::align_val_t{64}));
+    is.seekg(0);
+    if (!is.read(buffer, static_cast<std::streamsize>(_size))) {
+        ::operator delete(buffer, std::align_val_t{64});
+        throw std::runtime_error("cannot read " + path);
+    }
+    _data = buffer;
+#endif
+}
+
+// definition of the dtor of _file_mapping - out of the class
+inline _file_mapping::~_file_mapping() {
+#if _BST_MMAP
+    ::munmap(const_cast<char*>(_data), _size);
+#else
+    ::operator delete(const_cast<char*>(_data), std::align_val_t{64});
+#endif
+}
+
+#endif
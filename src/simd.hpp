@@ -0,0 +1,229 @@
+#ifndef _bst_simd
+#define _bst_simd
+
+#include <atomic>
+#include <cstddef>      //std::size_t
+#include <functional>   //std::less
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define _BST_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define _BST_SIMD_X86 0
+#endif
+
+/**
+ * ********* SIMD key search *********
+ *
+ * kernels searching a block of contiguous keys with one vector comparison per 16 or 32 bytes,
+ * for signed integer keys of 4 or 8 bytes, float and double ordered by std::less
+ * the instruction set is chosen at runtime (AVX2, SSE4.2 or the scalar loop), without compiling the
+ * whole program for it: the vector functions are compiled with a target attribute
+ * used by the trees wherever the keys are stored contiguously (e.g. the nodes of btree)
+ */
+
+
+/** instruction set used by the kernels */
+enum class simd_level { scalar = 0, sse4 = 1, avx2 = 2 };
+
+/** function simd_supported
+ * @return returns the best instruction set supported by the CPU */
+inline simd_level simd_supported() noexcept {
+#if _BST_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return simd_level::avx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return simd_level::sse4;
+    }
+#endif
+    return simd_level::scalar;
+}
+
+/** instruction set in use, the best one by default (atomic: simd_select may run while other threads search) */
+inline std::atomic<simd_level> _simd_level{simd_supported()};
+
+/** function simd_active
+ * @return returns the instruction set in use */
+inline simd_level simd_active() noexcept {return _simd_level.load(std::memory_order_relaxed);}
+
+/** function simd_select
+ * selects the instruction set used by the kernels (at most the supported one), e.g. to compare them */
+inline void simd_select(simd_level level) noexcept {
+    _simd_level.store(level < simd_supported() ? level : simd_supported(), std::memory_order_relaxed);
+}
+
+/** function simd_name
+ * @return returns the name of an instruction set */
+inline const char* simd_name(simd_level level) noexcept {
+    return level == simd_level::avx2 ? "avx2" : level == simd_level::sse4 ? "sse4.2" : "scalar";
+}
+
+
+/**
+ * trait _simd_key
+ * true for the key types supported by the kernels
+ */
+template<typename T>
+struct _simd_key : std::bool_constant<(std::is_integral_v<T> && std::is_signed_v<T> && (sizeof(T) == 4 || sizeof(T) == 8))
+                                      || std::is_same_v<T, float> || std::is_same_v<T, double>> {};
+
+/**
+ * trait _simd_searchable
+ * true if the keys k_t compared with OP can be searched by the kernels:
+ * a supported key type and the natural order (std::less<k_t> or std::less<>)
+ */
+template<typename k_t, typename OP>
+struct _simd_searchable : std::bool_constant<_simd_key<k_t>::value
+                                             && (std::is_same_v<OP, std::less<k_t>> || std::is_same_v<OP, std::less<>>)> {};
+
+
+/** _count_scalar: number of keys smaller (or greater, if Greater) than x */
+template<bool Greater, typename T>
+std::size_t _count_scalar(const T* a, std::size_t n, T x) noexcept {
+    std::size_t c = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        c += Greater ? (x < a[i]) : (a[i] < x);
+    }
+    return c;
+}
+
+#if _BST_SIMD_X86
+
+/** _count_sse4: as _count_scalar, 16 bytes at a time */
+template<bool Greater, typename T>
+__attribute__((target("sse4.2")))
+std::size_t _count_sse4(const T* a, std::size_t n, T x) noexcept {
+    constexpr std::size_t width = 16 / sizeof(T);
+    std::size_t c = 0;
+    std::size_t i = 0;
+    if constexpr (std::is_same_v<T, float>) {
+        __m128 xv = _mm_set1_ps(x);
+        for (; i + width <= n; i += width) {
+            __m128 v = _mm_loadu_ps(a + i);
+            c += __builtin_popcount(_mm_movemask_ps(Greater ? _mm_cmpgt_ps(v, xv) : _mm_cmplt_ps(v, xv)));
+        }
+    }
+    else if constexpr (std::is_same_v<T, double>) {
+        __m128d xv = _mm_set1_pd(x);
+        for (; i + width <= n; i += width) {
+            __m128d v = _mm_loadu_pd(a + i);
+            c += __builtin_popcount(_mm_movemask_pd(Greater ? _mm_cmpgt_pd(v, xv) : _mm_cmplt_pd(v, xv)));
+        }
+    }
+    else if constexpr (sizeof(T) == 4) {
+        __m128i xv = _mm_set1_epi32(static_cast<int>(x));
+        for (; i + width <= n; i += width) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i m = Greater ? _mm_cmpgt_epi32(v, xv) : _mm_cmpgt_epi32(xv, v);
+            c += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(m)));
+        }
+    }
+    else {
+        __m128i xv = _mm_set1_epi64x(static_cast<long long>(x));
+        for (; i + width <= n; i += width) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i m = Greater ? _mm_cmpgt_epi64(v, xv) : _mm_cmpgt_epi64(xv, v);
+            c += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(m)));
+        }
+    }
+    return c + _count_scalar<Greater>(a + i, n - i, x);
+}
+
+/** _count_avx2: as _count_scalar, 32 bytes at a time */
+template<bool Greater, typename T>
+__attribute__((target("avx2")))
+std::size_t _count_avx2(const T* a, std::size_t n, T x) noexcept {
+    constexpr std::size_t width = 32 / sizeof(T);
+    std::size_t c = 0;
+    std::size_t i = 0;
+    if constexpr (std::is_same_v<T, float>) {
+        __m256 xv = _mm256_set1_ps(x);
+        for (; i + width <= n; i += width) {
+            __m256 v = _mm256_loadu_ps(a + i);
+            __m256 m = Greater ? _mm256_cmp_ps(v, xv, _CMP_GT_OQ) : _mm256_cmp_ps(v, xv, _CMP_LT_OQ);
+            c += __builtin_popcount(_mm256_movemask_ps(m));
+        }
+    }
+    else if constexpr (std::is_same_v<T, double>) {
+        __m256d xv = _mm256_set1_pd(x);
+        for (; i + width <= n; i += width) {
+            __m256d v = _mm256_loadu_pd(a + i);
+            __m256d m = Greater ? _mm256_cmp_pd(v, xv, _CMP_GT_OQ) : _mm256_cmp_pd(v, xv, _CMP_LT_OQ);
+            c += __builtin_popcount(_mm256_movemask_pd(m));
+        }
+    }
+    else if constexpr (sizeof(T) == 4) {
+        __m256i xv = _mm256_set1_epi32(static_cast<int>(x));
+        for (; i + width <= n; i += width) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i m = Greater ? _mm256_cmpgt_epi32(v, xv) : _mm256_cmpgt_epi32(xv, v);
+            c += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+        }
+    }
+    else {
+        __m256i xv = _mm256_set1_epi64x(static_cast<long long>(x));
+        for (; i + width <= n; i += width) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i m = Greater ? _mm256_cmpgt_epi64(v, xv) : _mm256_cmpgt_epi64(xv, v);
+            c += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+        }
+    }
+    return c + _count_scalar<Greater>(a + i, n - i, x);
+}
+
+#endif
+
+/** _count: dispatches to the kernel of the instruction set in use */
+template<bool Greater, typename T>
+std::size_t _count(const T* a, std::size_t n, T x) noexcept {
+#if _BST_SIMD_X86
+    switch (_simd_level.load(std::memory_order_relaxed)) {
+        case simd_level::avx2: return _count_avx2<Greater>(a, n, x);
+        case simd_level::sse4: return _count_sse4<Greater>(a, n, x);
+        default: break;
+    }
+#endif
+    return _count_scalar<Greater>(a, n, x);
+}
+
+
+/**
+ * function simd_lower_bound
+ * position of the first key not smaller than x in the sorted array a of n keys
+ * a binary search without branches narrows the array to a window of a few vectors,
+ * whose keys smaller than x are counted all at once
+ */
+template<typename T>
+std::size_t simd_lower_bound(const T* a, std::size_t n, T x) noexcept {
+    static_assert(_simd_key<T>::value, "unsupported key type");
+    constexpr std::size_t window = 128 / sizeof(T);
+    const T* base = a;
+    while (n > window) {                  // keys before base are smaller than x, keys after base + n are not
+        std::size_t half = n / 2;
+        base = base[half] < x ? base + half : base;
+        n -= half;
+    }
+    return static_cast<std::size_t>(base - a) + _count<false>(base, n, x);
+}
+
+/**
+ * function simd_upper_bound
+ * position of the first key greater than x in the sorted array a of n keys
+ */
+template<typename T>
+std::size_t simd_upper_bound(const T* a, std::size_t n, T x) noexcept {
+    static_assert(_simd_key<T>::value, "unsupported key type");
+    constexpr std::size_t window = 128 / sizeof(T);
+    const T* base = a;
+    while (n > window) {                  // keys before base are not greater than x, keys after base + n are
+        std::size_t half = n / 2;
+        base = x < base[half] ? base : base + half;
+        n -= half;
+    }
+    return static_cast<std::size_t>(base - a) + n - _count<true>(base, n, x);
+}
+
+#endif
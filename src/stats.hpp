@@ -0,0 +1,177 @@
+#ifndef _bst_stats
+#define _bst_stats
+
+#include <cstddef>      //std::size_t
+#include <cstdint>      //std::uint64_t
+#include <ostream>
+#include <vector>
+
+/**
+ * ********* Instrumentation *********
+ *
+ * the shape of a tree (size, height, depth histogram) can always be inspected;
+ * compiled with -DBST_STATS every bst also counts the comparisons made by its lookups, insertions
+ * and removals and the nodes it allocates. Without BST_STATS the counters do not exist:
+ * the comparator of the tree is OP itself and stats() reports them as 0
+ *
+ * the counters live in the comparator: with BST_STATS the const lookups update them,
+ * so a tree read by several threads at once must not be compiled with it
+ */
+
+#ifdef BST_STATS
+inline constexpr bool bst_stats_enabled = true;
+#else
+inline constexpr bool bst_stats_enabled = false;
+#endif
+
+
+/** snapshot of a tree, returned by bst::stats() */
+struct bst_stats {
+    std::size_t size{0};
+    std::size_t height{0};                      // number of levels (0 if empty)
+    double average_depth{0};                    // mean depth of the nodes, the root at depth 0
+    std::vector<std::size_t> depth_histogram;   // number of nodes at each depth
+
+    // counters, since the tree was created (always 0 without BST_STATS)
+    std::uint64_t finds{0};                     // find, contains, lower_bound, upper_bound, ... (one per key for the batches)
+    std::uint64_t find_comparisons{0};
+    std::uint64_t inserts{0};                   // insert, emplace, try_emplace, operator[], also if the key is present
+    std::uint64_t insert_comparisons{0};
+    std::uint64_t erases{0};
+    std::uint64_t erase_comparisons{0};
+    std::uint64_t comparisons{0};               // all of them, e.g. also the check of the sorted ranges of assign
+    std::uint64_t allocations{0};               // nodes created
+
+    std::uint64_t auto_balances{0};             // calls of balance() made by auto_balance
+
+    /** function for_each_metric
+     * hands every number of the snapshot to an exporter, as f(name, value) with value converted to double
+     * (the histogram is left out: it has one entry per level) */
+    template<typename F>
+    void for_each_metric(F&& f) const {
+        f("size", static_cast<double>(size));
+        f("height", static_cast<double>(height));
+        f("average_depth", average_depth);
+        f("finds", static_cast<double>(finds));
+        f("find_comparisons", static_cast<double>(find_comparisons));
+        f("inserts", static_cast<double>(inserts));
+        f("insert_comparisons", static_cast<double>(insert_comparisons));
+        f("erases", static_cast<double>(erases));
+        f("erase_comparisons", static_cast<double>(erase_comparisons));
+        f("comparisons", static_cast<double>(comparisons));
+        f("allocations", static_cast<double>(allocations));
+        f("auto_balances", static_cast<double>(auto_balances));
+    }
+
+    /**  put-to operator: one "name value" line per metric, then the histogram as "depth count" pairs */
+    friend std::ostream& operator<<(std::ostream& os, const bst_stats& x) {
+        x.for_each_metric([&os](const char* name, double value) {os << name << ' ' << value << '\n';});
+        os << "depth_histogram";
+        for (std::size_t d = 0; d < x.depth_histogram.size(); ++d) {
+            os << ' ' << d << ':' << x.depth_histogram[d];
+        }
+        return os << '\n';
+    }
+};
+
+
+/** operations whose comparisons are counted */
+enum class _counted_op { find, insert, erase };
+
+/** counters of a tree (BST_STATS) */
+struct _op_counters {
+    std::uint64_t comparisons{0};
+    std::uint64_t calls[3]{};                   // indexed by _counted_op
+    std::uint64_t op_comparisons[3]{};
+    std::uint64_t allocations{0};
+    std::uint64_t start{0};                     // comparisons at the beginning of the outermost operation
+    unsigned nesting{0};                        // operations in progress (e.g. the lookup of an erase)
+};
+
+
+/**
+ * _op_scope
+ * attributes to one operation the comparisons made while it is alive; when operations are
+ * nested only the outermost one counts (the lookup made by erase is part of the erase)
+ */
+template<bool counted>
+class _op_scope {
+ public:
+    ~_op_scope() {}                             // user-provided: no warning for the unused scopes
+};
+
+template<>
+class _op_scope<true> {
+    _op_counters& _c;
+    _counted_op _op;
+    std::uint64_t _calls;
+
+ public:
+    _op_scope(_op_counters& c, _counted_op op, std::uint64_t calls) noexcept : _c{c}, _op{op}, _calls{calls} {
+        if (_c.nesting++ == 0) {
+            _c.start = _c.comparisons;
+        }
+    }
+
+    ~_op_scope() {
+        if (--_c.nesting == 0) {
+            auto i = static_cast<std::size_t>(_op);
+            _c.calls[i] += _calls;
+            _c.op_comparisons[i] += _c.comparisons - _c.start;
+        }
+    }
+
+    _op_scope(const _op_scope&) = delete;
+    _op_scope& operator=(const _op_scope&) = delete;
+};
+
+
+/**
+ * ********* Class _counting_compare *********
+ *
+ * the comparator stored by bst: OP itself (op) and, with BST_STATS, the counters of the tree
+ * a copy starts with the counters at 0, a move takes them along
+ */
+template<typename OP, bool counted = bst_stats_enabled>
+struct _counting_compare {
+    OP op;
+
+    template<typename A, typename B>
+    bool operator()(const A& a, const B& b) const {return op(a, b);}
+
+    _op_scope<false> scope(_counted_op, std::uint64_t = 1) const noexcept {return _op_scope<false>{};}
+    void allocated(std::uint64_t) const noexcept {}
+    const _op_counters* counters() const noexcept {return nullptr;}
+    void reset() noexcept {}
+};
+
+template<typename OP>
+struct _counting_compare<OP, true> {
+    OP op;
+    mutable _op_counters _counters;
+
+    _counting_compare() = default;
+    _counting_compare(const _counting_compare& x) : op{x.op} {}
+    _counting_compare(_counting_compare&&) = default;
+    _counting_compare& operator=(const _counting_compare& x) {
+        op = x.op;
+        _counters = _op_counters{};
+        return *this;
+    }
+    _counting_compare& operator=(_counting_compare&&) = default;
+
+    template<typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+        ++_counters.comparisons;
+        return op(a, b);
+    }
+
+    /** function scope
+     * @return returns the scope of an operation, to be kept alive until the operation ends */
+    _op_scope<true> scope(_counted_op o, std::uint64_t calls = 1) const noexcept {return _op_scope<true>{_counters, o, calls};}
+    void allocated(std::uint64_t n) const noexcept {_counters.allocations += n;}
+    const _op_counters* counters() const noexcept {return &_counters;}
+    void reset() noexcept {_counters = _op_counters{};}
+};
+
+#endif
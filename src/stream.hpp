@@ -0,0 +1,406 @@
+#ifndef _bst_stream
+#define _bst_stream
+#include "serialize.hpp"
+
+#include <cstddef>       //std::size_t
+#include <cstdio>        //std::FILE
+#include <cstring>       //std::memcpy, std::memchr
+#include <charconv>      //std::to_chars, std::from_chars
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <algorithm>     //std::min
+
+/**
+ * ********* Streams of records *********
+ *
+ * a tree is exported as a sequence of key/value records, formatted in a fixed buffer and handed
+ * to a sink one chunk at a time, and imported from a source of chunks in the same formats:
+ * - text:   "key value\n", the value is the rest of the line; in the strings a backslash, a new line and a
+ *           carriage return are escaped (\\ \n \r), and so are the spaces of the keys (\s)
+ * - csv:    "key,value\n", the strings with a comma, a quote or a new line are quoted ("" for a quote)
+ * - binary: the records of serializer<k_t> and serializer<v_t>, one after the other
+ * numbers are written with std::to_chars and read with std::from_chars (floating point values
+ * are written with the shortest representation that reads back the same value)
+ *
+ * a sink is any callable sink(const char* data, std::size_t n); a source is any callable
+ * source(char* buffer, std::size_t n) returning the number of bytes read, 0 at the end
+ */
+
+
+/** formats of the records */
+enum class record_format { text, csv, binary };
+
+/** sink writing to a std::ostream */
+struct ostream_sink {
+    std::ostream& os;
+    void operator()(const char* data, std::size_t n) {os.write(data, static_cast<std::streamsize>(n));}
+};
+
+/** sink writing to a C file (e.g. a pipe opened with popen) */
+struct file_sink {
+    std::FILE* file;
+    void operator()(const char* data, std::size_t n) {
+        if (std::fwrite(data, 1, n, file) != n) {
+            throw std::runtime_error("cannot write the records");
+        }
+    }
+};
+
+/** sink appending to a std::string */
+struct string_sink {
+    std::string& s;
+    void operator()(const char* data, std::size_t n) {s.append(data, n);}
+};
+
+/** source reading from a std::istream */
+struct istream_source {
+    std::istream& is;
+    std::size_t operator()(char* buffer, std::size_t n) {
+        is.read(buffer, static_cast<std::streamsize>(n));
+        return static_cast<std::size_t>(is.gcount());
+    }
+};
+
+/** source reading from a C file */
+struct file_source {
+    std::FILE* file;
+    std::size_t operator()(char* buffer, std::size_t n) {return std::fread(buffer, 1, n, file);}
+};
+
+/** source reading from a block of memory */
+struct string_source {
+    std::string_view s;
+    std::size_t operator()(char* buffer, std::size_t n) {
+        n = std::min(n, s.size());
+        std::memcpy(buffer, s.data(), n);
+        s.remove_prefix(n);
+        return n;
+    }
+};
+
+
+/** _malformed: error for a record that cannot be parsed */
+[[noreturn]] inline void _malformed(std::string_view record) {
+    throw std::runtime_error("malformed record: " + std::string{record.substr(0, 64)});
+}
+
+/** _text_type: types written as text, numbers (except bool) and std::string */
+template<typename T>
+struct _text_type : std::bool_constant<(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+                                       || std::is_same_v<T, std::string>> {};
+
+
+/**
+ * ********* Class _record_writer *********
+ *
+ * formats the records in a buffer of fixed size, handed to the sink when it is full
+ * no allocation per record: numbers are written in place with std::to_chars
+ */
+template<typename Sink>
+class _record_writer {
+
+    static constexpr std::size_t _capacity = std::size_t{1} << 15;
+    static constexpr std::size_t _number = 64;      // room for any number
+
+    Sink& _sink;
+    record_format _format;
+    std::size_t _used{0};
+    char _buffer[_capacity];
+
+    /** _room: flushes the buffer if fewer than n bytes are free (n <= _capacity) */
+    char* _room(std::size_t n) {
+        if (_capacity - _used < n) {
+            flush();
+        }
+        return _buffer + _used;
+    }
+
+    /** _put: one character */
+    void _put(char c) {
+        *_room(1) = c;
+        ++_used;
+    }
+
+    /** _quoted: string field of a csv record */
+    void _quoted(const std::string& x) {
+        if (x.find_first_of(",\"\r\n") == std::string::npos) {
+            write(x.data(), static_cast<std::streamsize>(x.size()));
+            return;
+        }
+        _put('"');
+        std::size_t from = 0;
+        for (std::size_t q; (q = x.find('"', from)) != std::string::npos; from = q + 1) {
+            write(x.data() + from, static_cast<std::streamsize>(q + 1 - from));
+            _put('"');                                      // quotes are doubled
+        }
+        write(x.data() + from, static_cast<std::streamsize>(x.size() - from));
+        _put('"');
+    }
+
+    /** _escaped: string field of a text record, the spaces are escaped only in the key */
+    void _escaped(const std::string& x, bool key) {
+        if (x.find_first_of(key ? " \\\r\n" : "\\\r\n") == std::string::npos) {
+            write(x.data(), static_cast<std::streamsize>(x.size()));
+            return;
+        }
+        for (char c : x) {
+            switch (c) {
+                case '\\': _put('\\'); _put('\\'); break;
+                case '\n': _put('\\'); _put('n'); break;
+                case '\r': _put('\\'); _put('r'); break;
+                case ' ':
+                    if (key) {
+                        _put('\\');
+                        _put('s');
+                        break;
+                    }
+                    [[fallthrough]];
+                default: _put(c);
+            }
+        }
+    }
+
+    /** _field: a key or a value of a text or csv record */
+    template<typename T>
+    void _field(const T& x, bool key) {
+        static_assert(_text_type<T>::value, "text and csv records hold numbers and std::string (use binary)");
+        if constexpr (std::is_same_v<T, std::string>) {
+            if (_format == record_format::csv) {
+                _quoted(x);
+            }
+            else {
+                _escaped(x, key);
+            }
+        }
+        else {
+            char* p = _room(_number);
+            _used = static_cast<std::size_t>(std::to_chars(p, p + _number, x).ptr - _buffer);
+        }
+    }
+
+ public:
+    /** custom ctor */
+    _record_writer(Sink& sink, record_format format) noexcept : _sink{sink}, _format{format} {}
+
+    _record_writer(const _record_writer&) = delete;
+    _record_writer& operator=(const _record_writer&) = delete;
+
+    /** function write: raw bytes (used by the serializers), larger blocks go through the buffer in pieces */
+    void write(const char* data, std::streamsize size) {
+        auto n = static_cast<std::size_t>(size);
+        while (n) {
+            char* p = _room(1);
+            std::size_t chunk = std::min(n, _capacity - _used);
+            std::memcpy(p, data, chunk);
+            _used += chunk;
+            data += chunk;
+            n -= chunk;
+        }
+    }
+
+    /** function record: appends one record */
+    template<typename K, typename V>
+    void record(const K& key, const V& value) {
+        if (_format == record_format::binary) {
+            serializer<K>::write(*this, key);
+            serializer<V>::write(*this, value);
+            return;
+        }
+        _field(key, true);
+        _put(_format == record_format::csv ? ',' : ' ');
+        _field(value, false);
+        _put('\n');
+    }
+
+    /** function flush: hands the buffer to the sink */
+    void flush() {
+        if (_used) {
+            _sink(static_cast<const char*>(_buffer), _used);
+            _used = 0;
+        }
+    }
+};
+
+
+/**
+ * ********* Class _record_reader *********
+ *
+ * reads the records from the source in chunks; a record that does not fit in the buffer
+ * makes it grow, so the only allocations are for the buffer and for the strings
+ */
+template<typename Source>
+class _record_reader {
+
+    Source& _source;
+    record_format _format;
+    std::vector<char> _buffer;
+    std::size_t _begin{0};           // first byte not parsed yet
+    std::size_t _end{0};             // end of the bytes read
+    bool _eof{false};
+
+    /** _fill: moves the bytes not parsed to the front and reads more (the buffer grows if it is full)
+     * @return returns false if the source is exhausted */
+    bool _fill() {
+        if (_eof) {
+            return false;
+        }
+        std::memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+        _end -= _begin;
+        _begin = 0;
+        if (_end == _buffer.size()) {
+            _buffer.resize(2 * _buffer.size());
+        }
+        std::size_t n = _source(_buffer.data() + _end, _buffer.size() - _end);
+        _end += n;
+        _eof = n == 0;
+        return n != 0;
+    }
+
+    /** _line_end: end of the text or csv record starting at _begin (at a new line outside quotes),
+     * or npos if it is not complete in the buffer */
+    std::size_t _line_end() const noexcept {
+        const char* first = _buffer.data() + _begin;
+        const char* last = _buffer.data() + _end;
+        if (_format == record_format::text) {
+            auto p = static_cast<const char*>(std::memchr(first, '\n', static_cast<std::size_t>(last - first)));
+            return p ? static_cast<std::size_t>(p - _buffer.data()) : std::string::npos;
+        }
+        bool quoted = false;
+        for (const char* p = first; p != last; ++p) {
+            if (*p == '"') {
+                quoted = !quoted;
+            }
+            else if (*p == '\n' && !quoted) {
+                return static_cast<std::size_t>(p - _buffer.data());
+            }
+        }
+        return std::string::npos;
+    }
+
+    /** _parse: a field of a text or csv record */
+    template<typename T>
+    static void _parse(std::string_view field, bool csv, T& x, std::string_view record) {
+        static_assert(_text_type<T>::value, "text and csv records hold numbers and std::string (use binary)");
+        if constexpr (std::is_same_v<T, std::string>) {
+            if (csv && !field.empty() && field.front() == '"') {
+                if (field.size() < 2 || field.back() != '"') {
+                    _malformed(record);
+                }
+                x.clear();
+                for (std::size_t i = 1; i + 1 < field.size(); ++i) {
+                    x.push_back(field[i]);
+                    i += field[i] == '"';                   // "" is a quote
+                }
+            }
+            else if (!csv && field.find('\\') != std::string_view::npos) {
+                x.clear();
+                for (std::size_t i = 0; i < field.size(); ++i) {
+                    if (field[i] != '\\') {
+                        x.push_back(field[i]);
+                        continue;
+                    }
+                    switch (++i < field.size() ? field[i] : '\0') {
+                        case '\\': x.push_back('\\'); break;
+                        case 'n': x.push_back('\n'); break;
+                        case 'r': x.push_back('\r'); break;
+                        case 's': x.push_back(' '); break;
+                        default: _malformed(record);           // unknown escape, or a backslash at the end
+                    }
+                }
+            }
+            else {
+                x.assign(field.data(), field.size());
+            }
+        }
+        else {
+            auto [p, ec] = std::from_chars(field.data(), field.data() + field.size(), x);
+            if (ec != std::errc{} || p != field.data() + field.size()) {
+                _malformed(record);
+            }
+        }
+    }
+
+    /** _split: separator between key and value, outside quotes for csv */
+    std::size_t _split(std::string_view record) const noexcept {
+        if (_format == record_format::text) {
+            return record.find(' ');
+        }
+        bool quoted = false;
+        for (std::size_t i = 0; i < record.size(); ++i) {
+            if (record[i] == '"') {
+                quoted = !quoted;
+            }
+            else if (record[i] == ',' && !quoted) {
+                return i;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+ public:
+    /** custom ctor */
+    _record_reader(Source& source, record_format format) : _source{source}, _format{format}, _buffer(std::size_t{1} << 15) {}
+
+    /** function record
+     * reads the next record
+     * @return returns false at the end of the source */
+    template<typename K, typename V>
+    bool record(K& key, V& value) {
+        if (_begin == _end && !_fill()) {
+            return false;
+        }
+        if (_format == record_format::binary) {
+            for (;;) {
+                const char* p = _buffer.data() + _begin;
+                try {
+                    key = serializer<K>::read(p, _buffer.data() + _end);
+                    value = serializer<V>::read(p, _buffer.data() + _end);
+                    _begin = static_cast<std::size_t>(p - _buffer.data());
+                    return true;
+                }
+                catch (truncated_error&) {
+                    if (!_fill()) {                          // the record is cut by the end of the source
+                        throw;
+                    }
+                }
+            }
+        }
+
+        std::string_view record;
+        for (;;) {                                           // blank lines (and "\r" lines) are skipped
+            std::size_t end;
+            while ((end = _line_end()) == std::string::npos) {
+                if (!_fill()) {
+                    end = _end;                              // last record, without a new line
+                    break;
+                }
+            }
+            record = std::string_view{_buffer.data() + _begin, end - _begin};
+            _begin = end < _end ? end + 1 : end;
+            if (!record.empty() && record.back() == '\r') {
+                record.remove_suffix(1);
+            }
+            if (!record.empty()) {
+                break;
+            }
+            if (_begin == _end && !_fill()) {
+                return false;
+            }
+        }
+        std::size_t sep = _split(record);
+        if (sep == std::string_view::npos) {
+            _malformed(record);
+        }
+        bool csv = _format == record_format::csv;
+        _parse(record.substr(0, sep), csv, key, record);
+        _parse(record.substr(sep + 1), csv, value, record);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef _bst_traits
+#define _bst_traits
+
+#include <type_traits>
+
+/**
+ * ********* Traits *********
+ *
+ * compile-time properties of the template arguments, shared by the tree classes
+ */
+
+
+/**
+ * trait _is_transparent
+ * true if the comparison operator O declares is_transparent (e.g. std::less<>), i.e. it can compare
+ * keys with objects of other types: in that case lookups accept any such type without building a key
+ */
+template<typename O, typename = void>
+struct _is_transparent : std::false_type {};
+
+template<typename O>
+struct _is_transparent<O, std::void_t<typename O::is_transparent>> : std::true_type {};
+
+
+/**
+ * trait _stores_height
+ * true if the per-node data M of a balancing policy has the height of the subtree (_height, e.g. avl_balance)
+ */
+template<typename M, typename = void>
+struct _stores_height : std::false_type {};
+
+template<typename M>
+struct _stores_height<M, std::void_t<decltype(M::_height)>> : std::true_type {};
+
+
+/**
+ * trait _stores_count
+ * true if the nodes N (or the per-node data of a policy) have the number of nodes of their subtree
+ * (_count, see order_statistics)
+ */
+template<typename N, typename = void>
+struct _stores_count : std::false_type {};
+
+template<typename N>
+struct _stores_count<N, std::void_t<decltype(N::_count)>> : std::true_type {};
+
+#endif